@@ -0,0 +1,77 @@
+#include <string.h>
+#include "ModelArena.h"
+
+
+// Operation Handling
+ModelArena::ModelArena(size_t size) {
+	block_size = size;
+}
+
+
+ModelArena::~ModelArena() {
+	clear();
+}
+
+
+void ModelArena::reserve(size_t size) {
+	if (!block_list.empty()) {
+		const Block& block = block_list.back();
+		if (block.size - block.used >= size) return;
+	}
+
+	Block block;
+	block.size = size > block_size ? size : block_size;
+	block.data = new uint8_t[block.size];
+	block.used = 0;
+	block_list.push_back(block);
+}
+
+
+void* ModelArena::allocate(size_t size, size_t align) {
+	// worst case padding is align - 1
+	if (block_list.empty()) reserve(size + align);
+
+	Block* block = &block_list.back();
+	size_t offset = (block->used + align - 1) & ~(align - 1);
+
+	if (offset + size > block->size) {
+		reserve(size + align);
+		block = &block_list.back();
+		offset = (block->used + align - 1) & ~(align - 1);
+	}
+
+	block->used = offset + size;
+	return block->data + offset;
+}
+
+
+char* ModelArena::copyString(const char* s) {
+	const size_t size = strlen(s) + 1;
+	char* result = (char*)allocate(size, 1);
+	memcpy(result, s, size);
+	return result;
+}
+
+
+// objects are destroyed first, in reverse creation order, then every block is freed at once
+void ModelArena::clear() {
+	for (size_t i = destructor_list.size(); i > 0; i--) {
+		destructor_list[i - 1].ops(destructor_list[i - 1].object);
+	}
+	destructor_list.clear();
+
+	for (Block& block : block_list) delete[] block.data;
+	block_list.clear();
+}
+
+
+size_t ModelArena::getUsedSize() {
+	size_t size = 0;
+	for (Block& block : block_list) size += block.used;
+	return size;
+}
+
+
+size_t ModelArena::getBlockCount() {
+	return block_list.size();
+}
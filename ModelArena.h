@@ -0,0 +1,82 @@
+#ifndef MODELARENA_H
+#define MODELARENA_H
+
+
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "stdint.h"
+
+
+// bump allocator owning every object of one scene
+// memory is taken from large blocks and released all at once in clear() / destructor,
+// objects created with create() have their destructor run at that point, in reverse order,
+// so clear() is linear in the objects that need one, trivially destructible objects are not tracked
+class ModelArena {
+
+// Data
+protected:
+	struct Block {
+		uint8_t*	data;
+		size_t		size;
+		size_t		used;
+	};
+
+	struct Destructor {
+		void	(*ops)(void* object);
+		void*	object;
+	};
+
+	std::vector<Block>		block_list;
+	std::vector<Destructor>	destructor_list;
+	size_t block_size;
+
+// Operation
+public:
+	ModelArena(size_t block_size = 64 * 1024);
+	~ModelArena();
+
+	// memory
+	// reserve: the next allocations, up to size bytes in total, come from one block
+	void reserve(size_t size);
+	void* allocate(size_t size, size_t align);
+	char* copyString(const char* s);
+	void clear();
+
+	// object
+	template <class T, class... Args>
+	T* create(Args&&... args) {
+		void* memory = allocate(sizeof(T), alignof(T));
+		T* object = new (memory) T(std::forward<Args>(args)...);
+		if (std::is_trivially_destructible<T>::value) return object;
+
+		Destructor destructor;
+		destructor.ops = &Helper_destroy<T>;
+		destructor.object = object;
+		destructor_list.push_back(destructor);
+		return object;
+	}
+
+	// array of trivially destructible values
+	template <class T>
+	T* createArray(size_t size) {
+		T* array = (T*)allocate(sizeof(T) * size, alignof(T));
+		for (size_t i = 0; i < size; i++) new (array + i) T();
+		return array;
+	}
+
+	// info
+	size_t getUsedSize();
+	size_t getBlockCount();
+
+// Static Function
+protected:
+	template <class T>
+	static void Helper_destroy(void* object) {
+		((T*)object)->~T();
+	}
+};
+
+
+#endif
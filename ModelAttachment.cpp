@@ -1,4 +1,5 @@
 #include "ModelAttachment.h"
+#include "ModelObject.h"
 
 
 // Static Data
@@ -18,10 +19,16 @@ ModelAttachment::ModelAttachment()
 }
 
 
+void ModelAttachment_Static::setOwner(ModelObject* object) {
+	owner = object;
+}
+
+
 void ModelAttachment_Static::setPoint(GLdouble x, GLdouble y, GLdouble z) {
 	point[0] = x;
 	point[1] = y;
 	point[2] = z;
+	if (owner != nullptr) owner->invalidateAttachMatrix();
 }
 
 
@@ -29,6 +36,7 @@ void ModelAttachment_Static::setRotation(GLdouble x, GLdouble y, GLdouble z) {
 	rotation[0] = x;
 	rotation[1] = y;
 	rotation[2] = z;
+	if (owner != nullptr) owner->invalidateAttachMatrix();
 }
 
 GLdouble* ModelAttachment_Static::getPoint() {
@@ -5,6 +5,9 @@
 #include <FL/gl.h>
 
 
+class ModelObject;
+
+
 class ModelAttachment {
 
 // Operation
@@ -27,12 +30,14 @@ class ModelAttachment_Static : public ModelAttachment {
 protected:
 	GLdouble point[3] = { 0 };
 	GLdouble rotation[3] = { 0 };
+	ModelObject* owner = nullptr;  // node whose cached attach matrix is dropped on set
 
 // Operation
 public:
 	ModelAttachment_Static();
 
 	// set
+	void setOwner(ModelObject* object);
 	void setPoint(GLdouble x, GLdouble y, GLdouble z) override;
 	void setRotation(GLdouble x, GLdouble y, GLdouble z) override;
 
@@ -0,0 +1,114 @@
+#include <math.h>
+#include "ModelBound.h"
+
+
+// Operation Handling
+ModelBound::ModelBound() {
+	setEmpty();
+}
+
+
+void ModelBound::set(const GLdouble* l, const GLdouble* u) {
+	for (int i = 0; i < 3; i++) {
+		lower[i] = l[i];
+		upper[i] = u[i];
+	}
+}
+
+
+void ModelBound::setEmpty() {
+	for (int i = 0; i < 3; i++) {
+		lower[i] = 1;
+		upper[i] = -1;
+	}
+}
+
+
+bool ModelBound::isEmpty() const {
+	return lower[0] > upper[0] || lower[1] > upper[1] || lower[2] > upper[2];
+}
+
+
+void ModelBound::merge(const ModelBound& bound) {
+	if (bound.isEmpty()) return;
+	if (isEmpty()) {
+		*this = bound;
+		return;
+	}
+
+	for (int i = 0; i < 3; i++) {
+		if (bound.lower[i] < lower[i]) lower[i] = bound.lower[i];
+		if (bound.upper[i] > upper[i]) upper[i] = bound.upper[i];
+	}
+}
+
+
+// center and half extent form (Arvo)
+// new center is mat * center, new half extent is |rotation-scale part| * half extent
+ModelBound ModelBound::transform(const Mat4d& mat) const {
+	ModelBound result;
+	if (isEmpty()) return result;
+
+	GLdouble center[3];
+	GLdouble extent[3];
+	for (int i = 0; i < 3; i++) {
+		center[i] = (lower[i] + upper[i]) / 2;
+		extent[i] = (upper[i] - lower[i]) / 2;
+	}
+
+	for (int row = 0; row < 3; row++) {
+		const GLdouble* m = mat.n + row * 4;
+		const GLdouble c = m[0] * center[0] + m[1] * center[1] + m[2] * center[2] + m[3];
+		const GLdouble e = fabs(m[0]) * extent[0] + fabs(m[1]) * extent[1] + fabs(m[2]) * extent[2];
+		result.lower[row] = c - e;
+		result.upper[row] = c + e;
+	}
+
+	return result;
+}
+
+
+ModelFrustum::ModelFrustum() {
+	set(Mat4d());
+}
+
+
+void ModelFrustum::set(const Mat4d& view_projection) {
+	// row-major, clip = view_projection * p
+	// plane = row 3 +/- row 0 (left, right), row 1 (bottom, top), row 2 (near, far)
+	const GLdouble* n = view_projection.n;
+
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 4; j++) {
+			plane[i * 2 + 0][j] = n[12 + j] + n[i * 4 + j];
+			plane[i * 2 + 1][j] = n[12 + j] - n[i * 4 + j];
+		}
+	}
+}
+
+
+ModelFrustum::Result ModelFrustum::test(const ModelBound& bound) const {
+	if (bound.isEmpty()) return OUTSIDE;
+
+	Result result = INSIDE;
+	for (int i = 0; i < 6; i++) {
+		const GLdouble* p = plane[i];
+
+		// corner furthest along the plane normal, and the one furthest against it
+		GLdouble d_max = p[3];
+		GLdouble d_min = p[3];
+		for (int j = 0; j < 3; j++) {
+			if (p[j] >= 0) {
+				d_max += p[j] * bound.upper[j];
+				d_min += p[j] * bound.lower[j];
+			} else {
+				d_max += p[j] * bound.lower[j];
+				d_min += p[j] * bound.upper[j];
+			}
+		}
+
+		if (d_max < 0) return OUTSIDE;
+		if (d_min < 0) result = INTERSECT;
+	}
+	return result;
+}
@@ -0,0 +1,61 @@
+#ifndef MODELBOUND_H
+#define MODELBOUND_H
+
+
+#include <FL/gl.h>
+#include "stdint.h"
+#include "vec.h"
+#include "mat.h"
+
+
+// axis aligned bounding box
+// empty when lower > upper (nothing drawn)
+class ModelBound {
+
+// Data
+public:
+	GLdouble lower[3];
+	GLdouble upper[3];
+
+// Operation
+public:
+	ModelBound();
+
+	void set(const GLdouble* l, const GLdouble* u);
+	void setEmpty();
+	bool isEmpty() const;
+
+	// grow to contain bound
+	void merge(const ModelBound& bound);
+
+	// bound of this box after mat, still axis aligned (may be larger than the exact box)
+	ModelBound transform(const Mat4d& mat) const;
+};
+
+
+// six planes of a view volume, extracted from projection * view (Gribb / Hartmann)
+// a point p is inside when dot(plane, (p, 1)) >= 0 for every plane
+class ModelFrustum {
+
+// Enum
+public:
+	enum Result {
+		OUTSIDE = 0,
+		INTERSECT,
+		INSIDE
+	};
+
+// Data
+protected:
+	GLdouble plane[6][4];
+
+// Operation
+public:
+	ModelFrustum();
+
+	void set(const Mat4d& view_projection);
+	Result test(const ModelBound& bound) const;
+};
+
+
+#endif
@@ -0,0 +1,36 @@
+#include "ModelChannelTable.h"
+
+
+// Operation Handling
+ModelChannelTable::ModelChannelTable() {
+}
+
+
+void ModelChannelTable::build(std::vector<ModelControl*>* controls) {
+	control_list = *controls;
+	value_list.resize(control_list.size());
+	gather();
+}
+
+
+int32_t ModelChannelTable::size() {
+	return value_list.size();
+}
+
+
+GLdouble* ModelChannelTable::getData() {
+	return value_list.data();
+}
+
+
+void ModelChannelTable::gather() {
+	for (size_t i = 0; i < control_list.size(); i++) value_list[i] = control_list[i]->getValue();
+}
+
+
+void ModelChannelTable::apply() {
+	for (size_t i = 0; i < control_list.size(); i++) {
+		if (control_list[i]->getValue() == value_list[i]) continue;
+		control_list[i]->setValue(value_list[i]);
+	}
+}
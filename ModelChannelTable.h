@@ -0,0 +1,39 @@
+#ifndef MODELCHANNELTABLE_H
+#define MODELCHANNELTABLE_H
+
+
+#include <FL/gl.h>
+#include <vector>
+#include "stdint.h"
+#include "ModelControl.h"
+
+
+// contiguous value block bound to a list of ModelControl
+// slot i holds the value of control i (same index as the curve / slider),
+// so all channels are evaluated into getData() in one pass and then scattered at once
+class ModelChannelTable {
+
+// Data
+protected:
+	std::vector<ModelControl*>	control_list;
+	std::vector<GLdouble>		value_list;
+
+// Operation
+public:
+	ModelChannelTable();
+
+	// bind
+	void build(std::vector<ModelControl*>* controls);
+
+	// value
+	int32_t size();
+	GLdouble* getData();
+
+	// gather: copy the current control values into the table
+	// apply: write the table to the controls, unchanged slots are skipped
+	void gather();
+	void apply();
+};
+
+
+#endif
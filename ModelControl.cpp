@@ -1,4 +1,5 @@
 #include "ModelControl.h"
+#include "ModelObject.h"
 
 
 // Operation Handling
@@ -16,7 +17,9 @@ void ModelControl::setLimit(GLdouble min, GLdouble max) {
 
 
 void ModelControl::setValue(GLdouble v) {
+	if (*value == v) return;
 	*value = v;
+	if (owner != nullptr) owner->invalidate();
 }
 
 
@@ -25,6 +28,11 @@ void ModelControl::appendName(const char* s) {
 }
 
 
+void ModelControl::setOwner(ModelObject* o) {
+	owner = o;
+}
+
+
 std::string* ModelControl::getName() {
 	return &(name);
 }
@@ -43,3 +51,8 @@ GLdouble ModelControl::getLimit_min() {
 GLdouble ModelControl::getLimit_max() {
 	return limit[1];
 }
+
+
+ModelObject* ModelControl::getOwner() {
+	return owner;
+}
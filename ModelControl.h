@@ -6,6 +6,9 @@
 #include <string>
 
 
+class ModelObject;
+
+
 class ModelControl {
 
 // Data
@@ -13,6 +16,7 @@ protected:
 	std::string name;
 	GLdouble* value;
 	GLdouble  limit[2];
+	ModelObject* owner = nullptr;	// invalidated when the value changes
 
 // Operation
 public:
@@ -22,12 +26,14 @@ public:
 	void setLimit(GLdouble min, GLdouble max);
 	void setValue(GLdouble value);
 	void appendName(const char* s);
+	void setOwner(ModelObject* owner);
 
 	// get
 	std::string* getName();
 	GLdouble getValue();
 	GLdouble getLimit_min();
 	GLdouble getLimit_max();
+	ModelObject* getOwner();
 };
 
 
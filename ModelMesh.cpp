@@ -0,0 +1,344 @@
+#include <math.h>
+#include "ModelMesh.h"
+
+
+// Static Data
+static const double MESH_PI = 3.14159265358979323846;
+
+
+// Static Function Prototype
+static void Helper_buildBox(ModelMesh* mesh);
+static void Helper_buildSphere(ModelMesh* mesh, int divisions);
+static void Helper_buildCylinder(ModelMesh* mesh, int slices, int stacks, double h, double r1, double r2);
+static void Helper_buildTorus(ModelMesh* mesh, int c, int t, double r1, double r2);
+static void Helper_buildPrism(ModelMesh* mesh);
+static void Helper_addFlatTriangle(ModelMesh* mesh, const GLfloat* a, const GLfloat* b, const GLfloat* c);
+
+
+// Operation Handling
+ModelMesh::ModelMesh() {
+}
+
+
+void ModelMesh::draw() const {
+	if (index_list.empty()) return;
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, vertex_list.data());
+	glNormalPointer(GL_FLOAT, 0, normal_list.data());
+
+	glDrawElements(GL_TRIANGLES, (GLsizei)index_list.size(), GL_UNSIGNED_INT, index_list.data());
+
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+
+GLuint ModelMesh::addVertex(GLfloat x, GLfloat y, GLfloat z, GLfloat nx, GLfloat ny, GLfloat nz) {
+	const GLuint index = (GLuint)(vertex_list.size() / 3);
+
+	vertex_list.push_back(x);
+	vertex_list.push_back(y);
+	vertex_list.push_back(z);
+
+	normal_list.push_back(nx);
+	normal_list.push_back(ny);
+	normal_list.push_back(nz);
+
+	return index;
+}
+
+
+void ModelMesh::addTriangle(GLuint a, GLuint b, GLuint c) {
+	index_list.push_back(a);
+	index_list.push_back(b);
+	index_list.push_back(c);
+}
+
+
+ModelMeshKey::ModelMeshKey(int32_t t) {
+	type = t;
+	value_i[0] = value_i[1] = 0;
+	value_d[0] = value_d[1] = value_d[2] = 0;
+}
+
+
+bool ModelMeshKey::operator <(const ModelMeshKey& key) const {
+	if (type != key.type) return type < key.type;
+	for (int i = 0; i < 2; i++) {
+		if (value_i[i] != key.value_i[i]) return value_i[i] < key.value_i[i];
+	}
+	for (int i = 0; i < 3; i++) {
+		if (value_d[i] != key.value_d[i]) return value_d[i] < key.value_d[i];
+	}
+	return false;
+}
+
+
+bool ModelMeshKey::operator ==(const ModelMeshKey& key) const {
+	return !(*this < key) && !(key < *this);
+}
+
+
+// never destroyed, so objects released at exit still find it
+ModelMeshCache* ModelMeshCache::Instance() {
+	static ModelMeshCache* instance = new ModelMeshCache();
+	return instance;
+}
+
+
+ModelMeshCache::ModelMeshCache() {
+}
+
+
+ModelMeshCache::~ModelMeshCache() {
+	for (auto& it : entry_map) delete it.second.mesh;
+}
+
+
+const ModelMesh* ModelMeshCache::get(const ModelMeshKey& key) {
+	Entry* entry = find(key);
+
+	// never released
+	if (entry->count >= 0) entry->count = -1;
+	return entry->mesh;
+}
+
+
+const ModelMesh* ModelMeshCache::acquire(const ModelMeshKey& key) {
+	Entry* entry = find(key);
+	if (entry->count >= 0) entry->count++;
+	return entry->mesh;
+}
+
+
+void ModelMeshCache::release(const ModelMeshKey& key) {
+	auto it = entry_map.find(key);
+	if (it == entry_map.end() || it->second.count < 0) return;
+
+	it->second.count--;
+	if (it->second.count > 0) return;
+
+	delete it->second.mesh;
+	entry_map.erase(it);
+}
+
+
+int32_t ModelMeshCache::size() {
+	return entry_map.size();
+}
+
+
+ModelMeshCache::Entry* ModelMeshCache::find(const ModelMeshKey& key) {
+	auto it = entry_map.find(key);
+	if (it != entry_map.end()) return &it->second;
+
+	Entry entry;
+	entry.mesh = Helper_build(key);
+	entry.count = 0;
+	return &(entry_map[key] = entry);
+}
+
+
+ModelMesh* ModelMeshCache::Helper_build(const ModelMeshKey& key) {
+	ModelMesh* mesh = new ModelMesh();
+
+	switch (key.type) {
+	case ModelMeshKey::MESH_BOX:
+		Helper_buildBox(mesh);
+		break;
+	case ModelMeshKey::MESH_SPHERE:
+		Helper_buildSphere(mesh, key.value_i[0]);
+		break;
+	case ModelMeshKey::MESH_CYLINDER:
+		Helper_buildCylinder(mesh, key.value_i[0], key.value_i[1], key.value_d[0], key.value_d[1], key.value_d[2]);
+		break;
+	case ModelMeshKey::MESH_TORUS:
+		Helper_buildTorus(mesh, key.value_i[0], key.value_i[1], key.value_d[0], key.value_d[1]);
+		break;
+	case ModelMeshKey::MESH_PRISM:
+		Helper_buildPrism(mesh);
+		break;
+	}
+
+	return mesh;
+}
+
+
+// Static Function Implementation
+// same faces as drawBox, four vertices per face for flat normals
+static void Helper_buildBox(ModelMesh* mesh) {
+	static const GLfloat face[6][3] = {
+		{ 0, 0, -1 }, { 0, -1, 0 }, { -1, 0, 0 },
+		{ 0, 0, 1 }, { 0, 1, 0 }, { 1, 0, 0 }
+	};
+	static const GLfloat corner[6][4][3] = {
+		{ { 0, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 }, { 1, 0, 0 } },
+		{ { 0, 0, 0 }, { 1, 0, 0 }, { 1, 0, 1 }, { 0, 0, 1 } },
+		{ { 0, 0, 0 }, { 0, 0, 1 }, { 0, 1, 1 }, { 0, 1, 0 } },
+		{ { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } },
+		{ { 0, 1, 0 }, { 0, 1, 1 }, { 1, 1, 1 }, { 1, 1, 0 } },
+		{ { 1, 0, 0 }, { 1, 1, 0 }, { 1, 1, 1 }, { 1, 0, 1 } }
+	};
+
+	for (int i = 0; i < 6; i++) {
+		GLuint index[4];
+		for (int j = 0; j < 4; j++) {
+			index[j] = mesh->addVertex(
+				corner[i][j][0], corner[i][j][1], corner[i][j][2],
+				face[i][0], face[i][1], face[i][2]);
+		}
+		mesh->addTriangle(index[0], index[1], index[2]);
+		mesh->addTriangle(index[0], index[2], index[3]);
+	}
+}
+
+
+// poles on the z axis, like gluSphere
+static void Helper_buildSphere(ModelMesh* mesh, int divisions) {
+	const int slices = divisions < 3 ? 3 : divisions;
+	const int stacks = divisions < 2 ? 2 : divisions;
+
+	for (int i = 0; i <= stacks; i++) {
+		const double phi = MESH_PI * i / stacks;
+		for (int j = 0; j <= slices; j++) {
+			const double theta = 2 * MESH_PI * j / slices;
+			const GLfloat x = (GLfloat)(sin(phi) * cos(theta));
+			const GLfloat y = (GLfloat)(sin(phi) * sin(theta));
+			const GLfloat z = (GLfloat)cos(phi);
+			mesh->addVertex(x, y, z, x, y, z);
+		}
+	}
+
+	const int row = slices + 1;
+	for (int i = 0; i < stacks; i++) {
+		for (int j = 0; j < slices; j++) {
+			const GLuint a = i * row + j;
+			const GLuint b = (i + 1) * row + j;
+			if (i != 0) mesh->addTriangle(a, b, a + 1);
+			if (i != stacks - 1) mesh->addTriangle(b, b + 1, a + 1);
+		}
+	}
+}
+
+
+// side and both caps, like gluCylinder and the two gluDisk of drawCylinder
+static void Helper_buildCylinder(ModelMesh* mesh, int slices, int stacks, double h, double r1, double r2) {
+	if (slices < 3) slices = 3;
+	if (stacks < 1) stacks = 1;
+
+	// side normal leans by the slope of the radius
+	const double slope = h != 0 ? (r1 - r2) / h : 0;
+	const double length = sqrt(1 + slope * slope);
+
+	for (int i = 0; i <= stacks; i++) {
+		const double z = h * i / stacks;
+		const double r = r1 + (r2 - r1) * i / stacks;
+		for (int j = 0; j <= slices; j++) {
+			const double theta = 2 * MESH_PI * j / slices;
+			mesh->addVertex(
+				(GLfloat)(r * cos(theta)), (GLfloat)(r * sin(theta)), (GLfloat)z,
+				(GLfloat)(cos(theta) / length), (GLfloat)(sin(theta) / length), (GLfloat)(slope / length));
+		}
+	}
+
+	const int row = slices + 1;
+	for (int i = 0; i < stacks; i++) {
+		for (int j = 0; j < slices; j++) {
+			const GLuint a = i * row + j;
+			const GLuint b = (i + 1) * row + j;
+			mesh->addTriangle(a, a + 1, b);
+			mesh->addTriangle(b, a + 1, b + 1);
+		}
+	}
+
+	// caps, flat normal, fan around the center
+	for (int k = 0; k < 2; k++) {
+		const double r = k == 0 ? r1 : r2;
+		if (r <= 0) continue;
+
+		const GLfloat z = k == 0 ? 0 : (GLfloat)h;
+		const GLfloat nz = k == 0 ? -1.0f : 1.0f;
+		const GLuint center = mesh->addVertex(0, 0, z, 0, 0, nz);
+
+		for (int j = 0; j <= slices; j++) {
+			const double theta = 2 * MESH_PI * j / slices;
+			mesh->addVertex((GLfloat)(r * cos(theta)), (GLfloat)(r * sin(theta)), z, 0, 0, nz);
+		}
+
+		for (int j = 0; j < slices; j++) {
+			const GLuint a = center + 1 + j;
+			if (k == 0) mesh->addTriangle(center, a + 1, a);
+			else mesh->addTriangle(center, a, a + 1);
+		}
+	}
+}
+
+
+// same parametrization as the former immediate mode torus of ModelObject_Torus
+static void Helper_buildTorus(ModelMesh* mesh, int c, int t, double r1, double r2) {
+	if (c < 1) c = 1;
+	if (t < 1) t = 1;
+
+	for (int i = 0; i <= c; i++) {
+		const double u = 2 * MESH_PI * (i + 0.5) / c;
+		for (int j = 0; j <= t; j++) {
+			const double v = 2 * MESH_PI * j / t;
+			const double r = r1 + r2 * cos(u);
+			mesh->addVertex(
+				(GLfloat)(r * cos(v)), (GLfloat)(r * sin(v)), (GLfloat)(r2 * sin(u)),
+				(GLfloat)(cos(u) * cos(v)), (GLfloat)(cos(u) * sin(v)), (GLfloat)sin(u));
+		}
+	}
+
+	const int row = t + 1;
+	for (int i = 0; i < c; i++) {
+		for (int j = 0; j < t; j++) {
+			const GLuint a = i * row + j;
+			const GLuint b = (i + 1) * row + j;
+			mesh->addTriangle(a, a + 1, b);
+			mesh->addTriangle(b, a + 1, b + 1);
+		}
+	}
+}
+
+
+// same triangles as ModelObject_Prism
+static void Helper_buildPrism(ModelMesh* mesh) {
+	static const GLfloat point[5][3] = {
+		{ -0.5f, 0, -0.5f }, { 0.5f, 0, -0.5f }, { 0.5f, 0, 0.5f }, { -0.5f, 0, 0.5f }, { 0, 1, 0 }
+	};
+
+	Helper_addFlatTriangle(mesh, point[0], point[1], point[2]);
+	Helper_addFlatTriangle(mesh, point[0], point[2], point[3]);
+	Helper_addFlatTriangle(mesh, point[0], point[1], point[4]);
+	Helper_addFlatTriangle(mesh, point[1], point[2], point[4]);
+	Helper_addFlatTriangle(mesh, point[2], point[3], point[4]);
+	Helper_addFlatTriangle(mesh, point[3], point[0], point[4]);
+}
+
+
+// normal is the cross product of two edges, as in drawTriangle
+static void Helper_addFlatTriangle(ModelMesh* mesh, const GLfloat* a, const GLfloat* b, const GLfloat* c) {
+	const GLfloat e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	const GLfloat e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+	GLfloat n[3] = {
+		e1[1] * e2[2] - e1[2] * e2[1],
+		e1[2] * e2[0] - e1[0] * e2[2],
+		e1[0] * e2[1] - e1[1] * e2[0]
+	};
+
+	const GLfloat length = (GLfloat)sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	if (length > 0) {
+		n[0] /= length;
+		n[1] /= length;
+		n[2] /= length;
+	}
+
+	const GLuint i0 = mesh->addVertex(a[0], a[1], a[2], n[0], n[1], n[2]);
+	const GLuint i1 = mesh->addVertex(b[0], b[1], b[2], n[0], n[1], n[2]);
+	const GLuint i2 = mesh->addVertex(c[0], c[1], c[2], n[0], n[1], n[2]);
+	mesh->addTriangle(i0, i1, i2);
+}
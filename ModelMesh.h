@@ -0,0 +1,89 @@
+#ifndef MODELMESH_H
+#define MODELMESH_H
+
+
+#include <FL/gl.h>
+#include <vector>
+#include <map>
+#include "stdint.h"
+
+
+// pre-tessellated triangle mesh, drawn from vertex arrays with a single glDrawElements
+class ModelMesh {
+
+// Data
+public:
+	std::vector<GLfloat>	vertex_list;	// xyz
+	std::vector<GLfloat>	normal_list;	// xyz, unit length
+	std::vector<GLuint>		index_list;		// triangles
+
+// Operation
+public:
+	ModelMesh();
+
+	void draw() const;
+
+	// build
+	GLuint addVertex(GLfloat x, GLfloat y, GLfloat z, GLfloat nx, GLfloat ny, GLfloat nz);
+	void addTriangle(GLuint a, GLuint b, GLuint c);
+};
+
+
+// primitive and the parameters its tessellation depends on
+// size given by glScale at draw time is not part of the key, so one mesh serves every instance
+struct ModelMeshKey {
+	enum Type {
+		MESH_BOX = 0,		// unit box, origin to (1, 1, 1)
+		MESH_SPHERE,		// unit radius,                      value_i: divisions
+		MESH_CYLINDER,		// z = 0 to h, radius r1 to r2,      value_i: slices, stacks; value_d: h, r1, r2
+		MESH_TORUS,			// on the xy plane,                  value_i: c, t;           value_d: r1, r2
+		MESH_PRISM			// unit square base, apex at (0, 1, 0)
+	};
+
+	int32_t		type;
+	int32_t		value_i[2];
+	double		value_d[3];
+
+	ModelMeshKey(int32_t type);
+
+	bool operator <(const ModelMeshKey& key) const;
+	bool operator ==(const ModelMeshKey& key) const;
+};
+
+
+// meshes keyed by ModelMeshKey, built once and shared
+// acquire / release count the users, a mesh is freed when the last user releases it
+// get keeps the mesh for the lifetime of the cache (for parameters that hardly ever change)
+class ModelMeshCache {
+
+// Data
+protected:
+	struct Entry {
+		ModelMesh*	mesh;
+		int32_t		count;
+	};
+
+	std::map<ModelMeshKey, Entry> entry_map;
+
+// Operation
+public:
+	static ModelMeshCache* Instance();
+	~ModelMeshCache();
+
+	const ModelMesh* get(const ModelMeshKey& key);
+	const ModelMesh* acquire(const ModelMeshKey& key);
+	void release(const ModelMeshKey& key);
+
+	int32_t size();
+
+protected:
+	ModelMeshCache();
+	Entry* find(const ModelMeshKey& key);
+
+// Static Function
+protected:
+	static ModelMesh* Helper_build(const ModelMeshKey& key);
+};
+
+
+#endif
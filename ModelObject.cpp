@@ -1,5 +1,7 @@
 #include "mat.h"
 #include "ModelObject.h"
+#include "ModelScene.h"
+#include "ModelRenderQueue.h"
 
 
 ModelObject::ModelObject() {
@@ -18,23 +20,29 @@ ModelObject::ModelObject() {
 
 
 void ModelObject::setOrigin(GLdouble x, GLdouble y, GLdouble z) {
+	if (origin[0] == x && origin[1] == y && origin[2] == z) return;
 	origin[0] = x;
 	origin[1] = y;
 	origin[2] = z;
+	invalidate();
 }
 
 
 void ModelObject::setDimension(GLdouble x, GLdouble y, GLdouble z) {
+	if (dimension[0] == x && dimension[1] == y && dimension[2] == z) return;
 	dimension[0] = x;
 	dimension[1] = y;
 	dimension[2] = z;
+	invalidate();
 }
 
 
 void ModelObject::setRotation(GLdouble x, GLdouble y, GLdouble z) {
+	if (rotation[0] == x && rotation[1] == y && rotation[2] == z) return;
 	rotation[0] = x;
 	rotation[1] = y;
 	rotation[2] = z;
+	invalidate();
 }
 
 
@@ -58,6 +66,11 @@ Mat4d ModelObject::getMatrix() {
 }
 
 
+void ModelObject::setMatrix(const Mat4d& mat) {
+	matrix = mat;
+}
+
+
 // TODO: currently no checking on tree structure
 bool ModelObject::add(ModelObject *child, uint32_t index) {
 	if (child == nullptr || index >= attach_size) return false;
@@ -68,70 +81,157 @@ bool ModelObject::add(ModelObject *child, uint32_t index) {
 }
 
 
+ModelObject* ModelObject::getParent() {
+	return parent;
+}
+
+
+std::vector<ModelObject*>* ModelObject::getChildren() {
+	return &children;
+}
+
+
+uint32_t ModelObject::getAttachIndex() {
+	return attach_index;
+}
+
+
+void ModelObject::setScene(ModelScene* s, int32_t index) {
+	scene = s;
+	scene_index = index;
+}
+
+
+void ModelObject::invalidate() {
+	if (scene != nullptr) scene->invalidate(scene_index);
+}
+
+
 void ModelObject::model() {
-	model(-1);
+	model(Mat4d(), -1);
 }
 
 
 void ModelObject::model(int32_t depth) {
-	Mat4d mat;
-	glGetDoublev(GL_MODELVIEW_MATRIX, mat.n);
-	mat = mat.transpose();
-	mat = mat.inverse();
-
-	model(mat, depth);
+	model(Mat4d(), depth);
 }
 
 
-void ModelObject::model(Mat4d mat) {
+void ModelObject::model(const Mat4d& mat) {
 	model(mat, -1);
 }
 
 
-void ModelObject::model(Mat4d mat, int32_t depth) {
+void ModelObject::model(const Mat4d& mat, int32_t depth) {
+	transform(mat, depth);
+	draw(depth);
+}
+
+
+void ModelObject::queueSelf(ModelRenderQueue* queue, const Mat4d& mat) {
+	queue->addNode(this, mat);
+}
+
+
+void ModelObject::exportSelf(ModelRayFile* file, const Mat4d& mat) {
+}
+
+
+void ModelObject::transform(const Mat4d& mat, int32_t depth) {
 	if (depth == 0) return;
 
 	// attachment rotation and translation
-	if (origin[0] != 0 || origin[1] != 0 || origin[2] != 0) glTranslated(origin[0], origin[1], origin[2]);
-	if (rotation[0] != 0) glRotated(rotation[0], 1, 0, 0);
-	if (rotation[1] != 0) glRotated(rotation[1], 0, 1, 0);
-	if (rotation[2] != 0) glRotated(rotation[2], 0, 0, 1);
+	matrix = mat * getLocalMatrix();
+
+	// child
+	transformChild(depth);
+}
+
+
+void ModelObject::transformChild(int32_t depth) {
+	for (ModelObject* child : children) {
+		child->transform(matrix * getAttachMatrix(child->attach_index), depth <= 0 ? depth : depth - 1);
+	}
+}
+
+
+void ModelObject::draw(int32_t depth) {
+	ModelRenderQueue queue;
+	draw(&queue, depth);
+	queue.submit();
+}
+
 
-	// get matrix
-	glGetDoublev(GL_MODELVIEW_MATRIX, matrix.n);
-	matrix = matrix.transpose();
-	matrix = mat * matrix;
+void ModelObject::draw(ModelRenderQueue* queue, int32_t depth) {
+	if (depth == 0) return;
 
 	// self
-	glPushMatrix();
-	modelSelf();
-	glPopMatrix();
+	queue->add(this, matrix);
 
 	// child
-	modelChild(mat, depth);
+	drawChild(queue, depth);
 }
 
 
-void ModelObject::modelChild(Mat4d mat, int32_t depth) {
-	for (ModelObject* child : children) {
-		glPushMatrix();
-
-		// joint translation and rotation
-		if (attach[child->attach_index]->getPoint()[0] != 0 ||
-			attach[child->attach_index]->getPoint()[1] != 0 ||
-			attach[child->attach_index]->getPoint()[2] != 0)
-			glTranslated(
-				attach[child->attach_index]->getPoint()[0],
-				attach[child->attach_index]->getPoint()[1],
-				attach[child->attach_index]->getPoint()[2]);
-
-		if (attach[child->attach_index]->getRotation()[0] != 0) glRotated(attach[child->attach_index]->getRotation()[0], 1, 0, 0);
-		if (attach[child->attach_index]->getRotation()[1] != 0) glRotated(attach[child->attach_index]->getRotation()[1], 0, 1, 0);
-		if (attach[child->attach_index]->getRotation()[2] != 0) glRotated(attach[child->attach_index]->getRotation()[2], 0, 0, 1);
-
-		child->model(mat, depth <= 0 ? depth : depth - 1);
-		glPopMatrix();
+void ModelObject::drawChild(ModelRenderQueue* queue, int32_t depth) {
+	for (ModelObject* child : children) child->draw(queue, depth <= 0 ? depth : depth - 1);
+}
+
+
+// translate(origin) * rotate-x * rotate-y * rotate-z, same order as the former glTranslated / glRotated calls
+Mat4d ModelObject::getLocalMatrix() {
+	return Helper_getMatrix(origin, rotation);
+}
+
+
+// joint translation and rotation of the given attachment
+const Mat4d& ModelObject::getAttachMatrix(uint32_t index) {
+	if (attach_matrix.size() != attach_size ||
+		attach_dimension[0] != dimension[0] ||
+		attach_dimension[1] != dimension[1] ||
+		attach_dimension[2] != dimension[2]) updateAttachMatrix();
+
+	return attach_matrix[index];
+}
+
+
+// dropping the cache makes the size check in getAttachMatrix fail
+void ModelObject::invalidateAttachMatrix() {
+	attach_matrix.clear();
+	invalidate();
+}
+
+
+// resolve every attachment once
+// static attachments drop the cache themselves, see invalidateAttachMatrix
+void ModelObject::updateAttachMatrix() {
+	attach_matrix.resize(attach_size);
+
+	for (uint32_t i = 0; i < attach_size; i++) {
+		// point and rotation may share the same buffer (ModelAttachment_Dynamic), copy point first
+		GLdouble point[3];
+		const GLdouble* p = attach[i]->getPoint();
+		point[0] = p[0];
+		point[1] = p[1];
+		point[2] = p[2];
+
+		attach_matrix[i] = Helper_getMatrix(point, attach[i]->getRotation());
 	}
+
+	attach_dimension[0] = dimension[0];
+	attach_dimension[1] = dimension[1];
+	attach_dimension[2] = dimension[2];
+}
+
+
+// box convention: centered on x and z, standing on y = 0
+ModelBound ModelObject::getLocalBound() {
+	const GLdouble lower[3] = { -dimension[0] / 2, 0, -dimension[2] / 2 };
+	const GLdouble upper[3] = { dimension[0] / 2, dimension[1], dimension[2] / 2 };
+
+	ModelBound bound;
+	bound.set(lower, upper);
+	return bound;
 }
 
 
@@ -140,6 +240,16 @@ void ModelObject::setName(const char* s) {
 }
 
 
+void ModelObject::setArena(ModelArena* a) {
+	arena = a;
+}
+
+
+ModelArena* ModelObject::getArena() {
+	return arena;
+}
+
+
 void ModelObject::control(std::vector<ModelControl*>* controls) {
 	control(controls, -1);
 }
@@ -162,10 +272,33 @@ void ModelObject::controlChild(std::vector<ModelControl*>* controls, int32_t dep
 }
 
 
+Mat4d ModelObject::Helper_getMatrix(const GLdouble* point, const GLdouble* rotation) {
+	const GLdouble degree_to_radian = 3.14159265358979323846 / 180;
+
+	Mat4d mat = Mat4d::createTranslation(point[0], point[1], point[2]);
+	if (rotation[0] != 0) mat = mat * Mat4d::createRotation(rotation[0] * degree_to_radian, 1, 0, 0);
+	if (rotation[1] != 0) mat = mat * Mat4d::createRotation(rotation[1] * degree_to_radian, 0, 1, 0);
+	if (rotation[2] != 0) mat = mat * Mat4d::createRotation(rotation[2] * degree_to_radian, 0, 0, 1);
+	return mat;
+}
+
+
+// control of model, with owner set, allocated from the arena of model when there is one
+ModelControl* ModelObject::Helper_createControl(ModelObject* model, GLdouble* value, GLdouble min, GLdouble max) {
+	ModelControl* control =
+		model->arena != nullptr ?
+		model->arena->create<ModelControl>(value, min, max) :
+		new ModelControl(value, min, max);
+
+	control->setOwner(model);
+	return control;
+}
+
+
 void ModelObject::Helper_addControl_dimension(ModelObject* model, std::vector<ModelControl*>* controls, GLdouble min, GLdouble max) {
-	ModelControl* control_0 = new ModelControl(model->dimension + 0, min, max);
-	ModelControl* control_1 = new ModelControl(model->dimension + 1, min, max);
-	ModelControl* control_2 = new ModelControl(model->dimension + 2, min, max);
+	ModelControl* control_0 = Helper_createControl(model, model->dimension + 0, min, max);
+	ModelControl* control_1 = Helper_createControl(model, model->dimension + 1, min, max);
+	ModelControl* control_2 = Helper_createControl(model, model->dimension + 2, min, max);
 
 	control_0->appendName(model->name);
 	control_1->appendName(model->name);
@@ -182,9 +315,9 @@ void ModelObject::Helper_addControl_dimension(ModelObject* model, std::vector<Mo
 
 
 void ModelObject::Helper_addControl_rotation(ModelObject* model, std::vector<ModelControl*>* controls, GLdouble min, GLdouble max) {
-	ModelControl* control_0 = new ModelControl(model->rotation + 0, min, max);
-	ModelControl* control_1 = new ModelControl(model->rotation + 1, min, max);
-	ModelControl* control_2 = new ModelControl(model->rotation + 2, min, max);
+	ModelControl* control_0 = Helper_createControl(model, model->rotation + 0, min, max);
+	ModelControl* control_1 = Helper_createControl(model, model->rotation + 1, min, max);
+	ModelControl* control_2 = Helper_createControl(model, model->rotation + 2, min, max);
 
 	control_0->appendName(model->name);
 	control_1->appendName(model->name);
@@ -201,9 +334,9 @@ void ModelObject::Helper_addControl_rotation(ModelObject* model, std::vector<Mod
 
 
 void ModelObject::Helper_addControl_origin(ModelObject* model, std::vector<ModelControl*>* controls, GLdouble min, GLdouble max) {
-	ModelControl* control_0 = new ModelControl(model->origin + 0, min, max);
-	ModelControl* control_1 = new ModelControl(model->origin + 1, min, max);
-	ModelControl* control_2 = new ModelControl(model->origin + 2, min, max);
+	ModelControl* control_0 = Helper_createControl(model, model->origin + 0, min, max);
+	ModelControl* control_1 = Helper_createControl(model, model->origin + 1, min, max);
+	ModelControl* control_2 = Helper_createControl(model, model->origin + 2, min, max);
 
 	control_0->appendName(model->name);
 	control_1->appendName(model->name);
@@ -8,7 +8,14 @@
 #include "vec.h"
 #include "mat.h"
 #include "ModelAttachment.h"
+#include "ModelBound.h"
 #include "ModelControl.h"
+#include "ModelArena.h"
+
+
+class ModelScene;
+class ModelRayFile;
+class ModelRenderQueue;
 
 
 class ModelObject {
@@ -23,6 +30,12 @@ protected:
 	ModelAttachment** attach = nullptr;
 	uint32_t attach_size = 0;  // number of attachment
 
+	// resolved joint matrix of each attachment
+	// attachments only depend on the dimension, so they are rebuilt when it differs from attach_dimension
+	// or when a static attachment with this node as owner is set
+	std::vector<Mat4d> attach_matrix;
+	GLdouble attach_dimension[3] = { 0 };
+
 	Mat4d matrix;
 
 	// tree
@@ -32,6 +45,11 @@ protected:
 
 	// control
 	const char* name = "";
+	ModelArena* arena = nullptr;	// owner of the controls created by this node, heap when null
+
+	// scene
+	ModelScene* scene = nullptr;
+	int32_t scene_index = -1;
 
 public:
 	// Operation
@@ -47,20 +65,56 @@ public:
 	GLdouble* getRotation();
 
 	Mat4d getMatrix();
+	void setMatrix(const Mat4d& mat);
 
 	// tree
 	virtual bool add(ModelObject *child, uint32_t index);
+	ModelObject* getParent();
+	std::vector<ModelObject*>* getChildren();
+	uint32_t getAttachIndex();
+
+	// scene
+	// geo changes mark the node dirty in the scene it is registered to
+	void setScene(ModelScene* scene, int32_t index);
+	void invalidate();
 
 	// model
+	// mat is the frame the tree is attached to, relative to the current GL modelview;
+	// world matrices are evaluated on the CPU and GL only receives the final matrix of each node
 	void model();
-	void model(Mat4d mat);
+	void model(const Mat4d& mat);
 	void model(int32_t depth);
-	void model(Mat4d mat, int32_t depth);
+	void model(const Mat4d& mat, int32_t depth);
 	virtual void modelSelf() = 0;
-	virtual void modelChild(Mat4d mat, int32_t depth);
+
+	// queue: add what modelSelf draws to a render queue, mat is the world matrix of this node
+	//        drawn through modelSelf by default
+	virtual void queueSelf(ModelRenderQueue* queue, const Mat4d& mat);
+
+	// export: add what modelSelf draws to a .ray file, mat is the world matrix of this node
+	//         nothing is exported by default
+	virtual void exportSelf(ModelRayFile* file, const Mat4d& mat);
+
+	// transform: evaluate matrix of the subtree, no GL call
+	// draw: draw the subtree with the evaluated matrices, through a render queue
+	void transform(const Mat4d& mat, int32_t depth);
+	virtual void transformChild(int32_t depth);
+	void draw(int32_t depth);
+	void draw(ModelRenderQueue* queue, int32_t depth);
+	virtual void drawChild(ModelRenderQueue* queue, int32_t depth);
+
+	Mat4d getLocalMatrix();
+
+	// bound of what modelSelf draws, in the frame of this node
+	virtual ModelBound getLocalBound();
+	const Mat4d& getAttachMatrix(uint32_t index);
+	void updateAttachMatrix();
+	void invalidateAttachMatrix();  // an attachment changed, rebuilt on the next getAttachMatrix
 
 	// control
 	void setName(const char* name);
+	void setArena(ModelArena* arena);  // this node only, children keep their own owner
+	ModelArena* getArena();
 	void control(std::vector<ModelControl*>* controls);
 	void control(std::vector<ModelControl*>* controls, int32_t depth);
 	void controlChild(std::vector<ModelControl*>* controls);
@@ -68,6 +122,8 @@ public:
 	virtual void controlChild(std::vector<ModelControl*>* controls, int32_t depth);
 
 	// helper
+	static Mat4d Helper_getMatrix(const GLdouble* point, const GLdouble* rotation);
+	static ModelControl* Helper_createControl(ModelObject* model, GLdouble* value, GLdouble min, GLdouble max);
 	static void Helper_addControl_dimension(ModelObject* model, std::vector<ModelControl*>* controls, GLdouble min, GLdouble max);
 	static void Helper_addControl_rotation(ModelObject* model, std::vector<ModelControl*>* controls, GLdouble min, GLdouble max);
 	static void Helper_addControl_origin(ModelObject* model, std::vector<ModelControl*>* controls, GLdouble min, GLdouble max);
@@ -1,5 +1,7 @@
 #include "modelerdraw.h"
 #include "ModelObject_Box.h"
+#include "ModelRayFile.h"
+#include "ModelRenderQueue.h"
 
 
 // Static Function Implementation
@@ -58,6 +60,24 @@ void ModelObject_Box::modelSelf() {
 }
 
 
+void ModelObject_Box::queueSelf(ModelRenderQueue* queue, const Mat4d& mat) {
+	queue->addMesh(
+		ModelMeshCache::Instance()->get(ModelMeshKey(ModelMeshKey::MESH_BOX)),
+		mat *
+		Mat4d::createTranslation(-dimension[0] / 2, 0, -dimension[2] / 2) *
+		Mat4d::createScale(dimension[0], dimension[1], dimension[2]));
+}
+
+
+// same placement as modelSelf, the .ray box is centered at origin
+void ModelObject_Box::exportSelf(ModelRayFile* file, const Mat4d& mat) {
+	file->addBox(
+		mat *
+		Mat4d::createTranslation(0, dimension[1] / 2, 0) *
+		Mat4d::createScale(dimension[0], dimension[1], dimension[2]));
+}
+
+
 void ModelObject_Box::controlSelf(std::vector<ModelControl*>* controls) {
 	Helper_addControl_rotation(this, controls, -180, 180);
 }
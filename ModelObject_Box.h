@@ -20,6 +20,8 @@ public:
 
 	// model
 	void modelSelf() override;
+	void queueSelf(ModelRenderQueue* queue, const Mat4d& mat) override;
+	void exportSelf(ModelRayFile* file, const Mat4d& mat) override;
 	void controlSelf(std::vector<ModelControl*>* controls) override;
 
 // Static Function
@@ -1,5 +1,7 @@
 #include "modelerdraw.h"
 #include "ModelObject_Cylinder.h"
+#include "ModelRayFile.h"
+#include "ModelRenderQueue.h"
 
 
 ModelObject_Cylinder::ModelObject_Cylinder() :
@@ -53,10 +55,51 @@ void ModelObject_Cylinder::modelSelf() {
 }
 
 
+void ModelObject_Cylinder::queueSelf(ModelRenderQueue* queue, const Mat4d& mat) {
+	queue->addMesh(ModelMeshCache::Instance()->get(getMeshKey()), mat * getMeshMatrix());
+}
+
+
+// the mesh drawPolygon draws, so the .ray output has the same 16 sides
+void ModelObject_Cylinder::exportSelf(ModelRayFile* file, const Mat4d& mat) {
+	file->addMesh(mat * getMeshMatrix(), getMeshKey());
+}
+
+
+// drawPolygon(16, 1, 1, 1) of modelSelf
+ModelMeshKey ModelObject_Cylinder::getMeshKey() {
+	ModelMeshKey key(ModelMeshKey::MESH_CYLINDER);
+	key.value_i[0] = 16;
+	key.value_i[1] = 1;
+	key.value_d[0] = 1;
+	key.value_d[1] = 1;
+	key.value_d[2] = 1;
+	return key;
+}
+
+
+Mat4d ModelObject_Cylinder::getMeshMatrix() {
+	return
+		Mat4d::createRotation(-3.14159265358979323846 / 2, 1, 0, 0) *
+		Mat4d::createScale(dimension[0], dimension[2], dimension[1]);
+}
+
+
+// radius dimension x / z, height dimension y
+ModelBound ModelObject_Cylinder::getLocalBound() {
+	const GLdouble lower[3] = { -dimension[0], 0, -dimension[2] };
+	const GLdouble upper[3] = { dimension[0], dimension[1], dimension[2] };
+
+	ModelBound bound;
+	bound.set(lower, upper);
+	return bound;
+}
+
+
 void ModelObject_Cylinder::controlSelf(std::vector<ModelControl*>* controls) {
-	ModelControl* control_0 = new ModelControl(rotation + 0, -180, 180);
-	ModelControl* control_1 = new ModelControl(rotation + 1, -180, 180);
-	ModelControl* control_2 = new ModelControl(rotation + 2, -180, 180);
+	ModelControl* control_0 = Helper_createControl(this, rotation + 0, -180, 180);
+	ModelControl* control_1 = Helper_createControl(this, rotation + 1, -180, 180);
+	ModelControl* control_2 = Helper_createControl(this, rotation + 2, -180, 180);
 
 	control_0->appendName(name);
 	control_1->appendName(name);
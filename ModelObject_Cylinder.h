@@ -3,6 +3,7 @@
 
 
 #include "ModelObject.h"
+#include "ModelMesh.h"
 
 
 class ModelObject_Cylinder : public ModelObject {
@@ -20,7 +21,14 @@ public:
 
 	// model
 	void modelSelf() override;
+	void queueSelf(ModelRenderQueue* queue, const Mat4d& mat) override;
+	void exportSelf(ModelRayFile* file, const Mat4d& mat) override;
 	void controlSelf(std::vector<ModelControl*>* controls) override;
+	ModelBound getLocalBound() override;
+
+protected:
+	ModelMeshKey getMeshKey();
+	Mat4d getMeshMatrix();
 
 // Static Function
 protected:
@@ -1,6 +1,9 @@
 #include "ModelObject_Prism.h"
+#include "ModelRayFile.h"
+#include "ModelRenderQueue.h"
 #include "modelerdraw.h"
 #include "stdio.h"
+#include "ModelMesh.h"
 
 
 // Operation
@@ -11,6 +14,13 @@ ModelObject::ModelObject()
 
 
 void ModelObject_Prism::modelSelf() {
+	// the .ray output needs the individual triangles
+	if (ModelerDrawState::Instance()->m_rayFile == NULL) {
+		applyDrawState();
+		ModelMeshCache::Instance()->get(ModelMeshKey(ModelMeshKey::MESH_PRISM))->draw();
+		return;
+	}
+
 	// draw the base
 	drawTriangle(
 		-0.5, 0, -0.5,
@@ -41,6 +51,27 @@ void ModelObject_Prism::modelSelf() {
 }
 
 
+void ModelObject_Prism::queueSelf(ModelRenderQueue* queue, const Mat4d& mat) {
+	queue->addMesh(ModelMeshCache::Instance()->get(ModelMeshKey(ModelMeshKey::MESH_PRISM)), mat);
+}
+
+
+void ModelObject_Prism::exportSelf(ModelRayFile* file, const Mat4d& mat) {
+	file->addMesh(mat, ModelMeshKey(ModelMeshKey::MESH_PRISM));
+}
+
+
+// unit prism, dimension is not used
+ModelBound ModelObject_Prism::getLocalBound() {
+	const GLdouble lower[3] = { -0.5, 0, -0.5 };
+	const GLdouble upper[3] = { 0.5, 1, 0.5 };
+
+	ModelBound bound;
+	bound.set(lower, upper);
+	return bound;
+}
+
+
 void ModelObject_Prism::controlSelf(std::vector<ModelControl*>* controls) {
 	return;
 }
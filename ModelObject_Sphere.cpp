@@ -1,5 +1,7 @@
 #include "modelerdraw.h"
 #include "ModelObject_Sphere.h"
+#include "ModelRayFile.h"
+#include "ModelRenderQueue.h"
 
 
 ModelObject_Sphere::ModelObject_Sphere():
@@ -18,10 +20,32 @@ void ModelObject_Sphere::modelSelf() {
 }
 
 
+// tessellated for its size on screen
+void ModelObject_Sphere::queueSelf(ModelRenderQueue* queue, const Mat4d& mat) {
+	ModelMeshKey key(ModelMeshKey::MESH_SPHERE);
+	key.value_i[0] = getQualityDivisions(queue->selectQuality(getLocalBound().transform(mat)));
+
+	queue->addMesh(ModelMeshCache::Instance()->get(key), mat * getMeshMatrix());
+}
+
+
+void ModelObject_Sphere::exportSelf(ModelRayFile* file, const Mat4d& mat) {
+	file->addSphere(mat * getMeshMatrix());
+}
+
+
+// unit sphere to the sphere modelSelf draws
+Mat4d ModelObject_Sphere::getMeshMatrix() {
+	return
+		Mat4d::createTranslation(0, dimension[1] / 2, 0) *
+		Mat4d::createScale(dimension[0] / 2, dimension[1] / 2, dimension[2] / 2);
+}
+
+
 void ModelObject_Sphere::controlSelf(std::vector<ModelControl*>* controls) {
-	ModelControl* control_0 = new ModelControl(rotation + 0, -180, 180);
-	ModelControl* control_1 = new ModelControl(rotation + 1, -180, 180);
-	ModelControl* control_2 = new ModelControl(rotation + 2, -180, 180);
+	ModelControl* control_0 = Helper_createControl(this, rotation + 0, -180, 180);
+	ModelControl* control_1 = Helper_createControl(this, rotation + 1, -180, 180);
+	ModelControl* control_2 = Helper_createControl(this, rotation + 2, -180, 180);
 
 	control_0->appendName(name);
 	control_1->appendName(name);
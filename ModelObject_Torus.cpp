@@ -1,12 +1,11 @@
 #include "ModelObject_Torus.h"
+#include "modelerdraw.h"
+#include "ModelRayFile.h"
+#include "ModelRenderQueue.h"
 #include <cmath>
 #include <math.h>
 
 
-// Static Function Prototype
-static void torus(int c, int t, GLdouble r_1, GLdouble r_2);
-
-
 // Operation
 ModelObject_Torus::ModelObject_Torus() :
 	ModelObject::ModelObject()
@@ -14,17 +13,79 @@ ModelObject_Torus::ModelObject_Torus() :
 }
 
 
+ModelObject_Torus::~ModelObject_Torus() {
+    if (mesh != nullptr) ModelMeshCache::Instance()->release(mesh_key);
+}
+
+
+void ModelObject_Torus::setParameter(GLdouble c, GLdouble t, GLdouble r_1, GLdouble r_2) {
+    torus_c = c;
+    torus_t = t;
+    torus_r_1 = r_1;
+    torus_r_2 = r_2;
+    invalidate();
+}
+
+
 void ModelObject_Torus::modelSelf() {
+    applyDrawState();
     glRotated(90, 1, 0, 0);
-    torus((int)torus_c, (int)torus_t, torus_r_1, torus_r_2);
+    getMesh()->draw();
+}
+
+
+void ModelObject_Torus::queueSelf(ModelRenderQueue* queue, const Mat4d& mat) {
+    queue->addMesh(getMesh(), mat * Mat4d::createRotation(3.14159265358979323846 / 2, 1, 0, 0));
+}
+
+
+void ModelObject_Torus::exportSelf(ModelRayFile* file, const Mat4d& mat) {
+    file->addMesh(mat * Mat4d::createRotation(3.14159265358979323846 / 2, 1, 0, 0), getMeshKey());
+}
+
+
+// mesh of the current parameters, rebuilt only when they change
+const ModelMesh* ModelObject_Torus::getMesh() {
+    const ModelMeshKey key = getMeshKey();
+
+    if (mesh == nullptr || !(key == mesh_key)) {
+        const ModelMesh* next = ModelMeshCache::Instance()->acquire(key);
+        if (mesh != nullptr) ModelMeshCache::Instance()->release(mesh_key);
+        mesh = next;
+        mesh_key = key;
+    }
+
+    return mesh;
+}
+
+
+ModelMeshKey ModelObject_Torus::getMeshKey() {
+    ModelMeshKey key(ModelMeshKey::MESH_TORUS);
+    key.value_i[0] = (int)torus_c;
+    key.value_i[1] = (int)torus_t;
+    key.value_d[0] = torus_r_1;
+    key.value_d[1] = torus_r_2;
+    return key;
+}
+
+
+// ring lies on the xz plane after the rotation in modelSelf
+ModelBound ModelObject_Torus::getLocalBound() {
+    const GLdouble r = torus_r_1 + torus_r_2;
+    const GLdouble lower[3] = { -r, -torus_r_2, -r };
+    const GLdouble upper[3] = { r, torus_r_2, r };
+
+    ModelBound bound;
+    bound.set(lower, upper);
+    return bound;
 }
 
 
 void ModelObject_Torus::controlSelf(std::vector<ModelControl*>* controls) {
-    ModelControl* control_0 = new ModelControl(&torus_c, 1, 50);
-    ModelControl* control_1 = new ModelControl(&torus_t, 1, 50);
-    ModelControl* control_2 = new ModelControl(&torus_r_1, 0.1, 10);
-    ModelControl* control_3 = new ModelControl(&torus_r_2, 0.1, 10);
+    ModelControl* control_0 = Helper_createControl(this, &torus_c, 1, 50);
+    ModelControl* control_1 = Helper_createControl(this, &torus_t, 1, 50);
+    ModelControl* control_2 = Helper_createControl(this, &torus_r_1, 0.1, 10);
+    ModelControl* control_3 = Helper_createControl(this, &torus_r_2, 0.1, 10);
 
     control_0->appendName(name);
     control_1->appendName(name);
@@ -41,27 +102,3 @@ void ModelObject_Torus::controlSelf(std::vector<ModelControl*>* controls) {
     controls->push_back(control_2);
     controls->push_back(control_3);
 }
-
-
-// Static Function Implementation
-static void torus(int numc, int numt, GLdouble r_1, GLdouble r_2) {
-    int i, j, k;
-    double s, t, x, y, z, twopi;
-
-    twopi = 2 * (double)3.14159265358979353;
-    for (i = 0; i < numc; i++) {
-        glBegin(GL_QUAD_STRIP);
-        for (j = 0; j <= numt; j++) {
-            for (k = 1; k >= 0; k--) {
-                s = (i + k) % numc + 0.5;
-                t = j % numt;
-
-                x = (r_1 + r_2 * cos(s * twopi / numc)) * cos(t * twopi / numt);
-                y = (r_1 + r_2 * cos(s * twopi / numc)) * sin(t * twopi / numt);
-                z = r_2 * sin(s * twopi / numc);
-                glVertex3f(x, y, z);
-            }
-        }
-        glEnd();
-    }
-}
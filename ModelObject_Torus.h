@@ -3,6 +3,7 @@
 
 
 #include "ModelObject.h"
+#include "ModelMesh.h"
 
 
 class ModelObject_Torus : public ModelObject {
@@ -14,13 +15,29 @@ protected:
 	GLdouble torus_r_1 =1;
 	GLdouble torus_r_2 = 0.25;
 
+	// mesh of the current parameters, rebuilt only when they change
+	ModelMeshKey mesh_key = ModelMeshKey(ModelMeshKey::MESH_TORUS);
+	const ModelMesh* mesh = nullptr;
+
 // Operation
 public:
 	ModelObject_Torus();
+	~ModelObject_Torus();
+
+	// torus
+	// c and t are the divisions around the ring and around the tube
+	void setParameter(GLdouble c, GLdouble t, GLdouble r_1, GLdouble r_2);
 
 	// model
 	void modelSelf() override;
+	void queueSelf(ModelRenderQueue* queue, const Mat4d& mat) override;
+	void exportSelf(ModelRayFile* file, const Mat4d& mat) override;
 	void controlSelf(std::vector<ModelControl*>* controls) override;
+	ModelBound getLocalBound() override;
+
+protected:
+	const ModelMesh* getMesh();
+	ModelMeshKey getMeshKey();
 };
 
 
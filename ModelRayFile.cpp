@@ -0,0 +1,225 @@
+#include <cstdio>
+#include <cstdarg>
+#include "ModelRayFile.h"
+
+
+// Operation Handling
+ModelRayFile::ModelRayFile() {
+}
+
+
+ModelRayFile::~ModelRayFile() {
+	clear();
+}
+
+
+void ModelRayFile::clear() {
+	for (ModelRayPrimitive& primitive : primitive_list) {
+		if (primitive.type == ModelRayPrimitive::RAY_MESH) ModelMeshCache::Instance()->release(primitive.mesh_key);
+	}
+
+	primitive_list.clear();
+	light_list.clear();
+}
+
+
+// view rows are side, up and -forward, the last column is -rotation * position
+void ModelRayFile::setCamera(const Mat4d& view, GLdouble fov, GLdouble aspect) {
+	const GLdouble* n = view.n;
+
+	for (int i = 0; i < 3; i++) {
+		camera_position[i] = -(n[i] * n[3] + n[4 + i] * n[7] + n[8 + i] * n[11]);
+		camera_direction[i] = -n[8 + i];
+		camera_up[i] = n[4 + i];
+	}
+
+	camera_fov = fov;
+	camera_aspect = aspect;
+}
+
+
+void ModelRayFile::addDirectionalLight(const GLfloat* direction, const GLfloat* color) {
+	for (int i = 0; i < 3; i++) light_list.push_back(direction[i]);
+	for (int i = 0; i < 3; i++) light_list.push_back(color[i]);
+}
+
+
+void ModelRayFile::setMaterial(const GLfloat* diffuse, const GLfloat* ambient) {
+	for (int i = 0; i < 3; i++) {
+		material_diffuse[i] = diffuse[i];
+		material_ambient[i] = ambient[i];
+	}
+}
+
+
+void ModelRayFile::addSphere(const Mat4d& mat) {
+	addPrimitive(ModelRayPrimitive::RAY_SPHERE, mat);
+}
+
+
+void ModelRayFile::addBox(const Mat4d& mat) {
+	addPrimitive(ModelRayPrimitive::RAY_BOX, mat);
+}
+
+
+void ModelRayFile::addMesh(const Mat4d& mat, const ModelMeshKey& key) {
+	addPrimitive(ModelRayPrimitive::RAY_MESH, mat);
+
+	ModelRayPrimitive& primitive = primitive_list.back();
+	primitive.mesh_key = key;
+	primitive.mesh = ModelMeshCache::Instance()->acquire(key);
+}
+
+
+int32_t ModelRayFile::size() {
+	return primitive_list.size();
+}
+
+
+const std::string& ModelRayFile::format() {
+	buffer.clear();
+
+	append("SBT-raytracer 1.0\n\n");
+	append(
+		"camera {\n"
+		"\tposition=(%g,%g,%g);\n"
+		"\tviewdir=(%g,%g,%g);\n"
+		"\tupdir=(%g,%g,%g);\n"
+		"\tfov=%g;\n"
+		"\taspectratio=%g;\n"
+		"}\n\n",
+		camera_position[0], camera_position[1], camera_position[2],
+		camera_direction[0], camera_direction[1], camera_direction[2],
+		camera_up[0], camera_up[1], camera_up[2],
+		camera_fov, camera_aspect);
+
+	for (size_t i = 0; i + 6 <= light_list.size(); i += 6) {
+		const GLfloat* light = light_list.data() + i;
+		append(
+			"directional_light { direction=(%g,%g,%g); color=(%g,%g,%g); }\n\n",
+			light[0], light[1], light[2], light[3], light[4], light[5]);
+	}
+
+	for (const ModelRayPrimitive& primitive : primitive_list) {
+		appendMatrix(primitive.matrix);
+
+		switch (primitive.type) {
+		case ModelRayPrimitive::RAY_SPHERE:
+			append("sphere {\n");
+			break;
+		case ModelRayPrimitive::RAY_BOX:
+			append("box {\n");
+			break;
+		case ModelRayPrimitive::RAY_MESH:
+			append("polymesh {\n");
+			appendMesh(primitive);
+			break;
+		}
+
+		appendMaterial(primitive);
+		append("})\n\n");
+	}
+
+	return buffer;
+}
+
+
+// one fwrite of the formatted file
+bool ModelRayFile::save(const char* path) {
+	format();
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) return false;
+
+	const bool is_written = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+	return (fclose(file) == 0) && is_written;
+}
+
+
+void ModelRayFile::addPrimitive(int32_t type, const Mat4d& mat) {
+	ModelRayPrimitive primitive;
+	primitive.type = type;
+	primitive.matrix = mat;
+	for (int i = 0; i < 3; i++) {
+		primitive.diffuse[i] = material_diffuse[i];
+		primitive.ambient[i] = material_ambient[i];
+	}
+
+	primitive_list.push_back(primitive);
+}
+
+
+void ModelRayFile::appendMatrix(const Mat4d& mat) {
+	const GLdouble* n = mat.n;
+	append(
+		"transform(\n"
+		"\t(%g,%g,%g,%g),\n"
+		"\t(%g,%g,%g,%g),\n"
+		"\t(%g,%g,%g,%g),\n"
+		"\t(%g,%g,%g,%g),\n",
+		n[0], n[1], n[2], n[3],
+		n[4], n[5], n[6], n[7],
+		n[8], n[9], n[10], n[11],
+		n[12], n[13], n[14], n[15]);
+}
+
+
+void ModelRayFile::appendMaterial(const ModelRayPrimitive& primitive) {
+	append(
+		"\tmaterial={ diffuse=(%g,%g,%g); ambient=(%g,%g,%g); }\n",
+		primitive.diffuse[0], primitive.diffuse[1], primitive.diffuse[2],
+		primitive.ambient[0], primitive.ambient[1], primitive.ambient[2]);
+}
+
+
+void ModelRayFile::appendMesh(const ModelRayPrimitive& primitive) {
+	const ModelMesh* mesh = primitive.mesh;
+
+	const size_t vertex_size = mesh->vertex_list.size() / 3;
+	const GLfloat* vertex = mesh->vertex_list.data();
+	const GLfloat* normal = mesh->normal_list.data();
+
+	append("\tpoints=(");
+	for (size_t i = 0; i < vertex_size; i++) {
+		append(i == 0 ? "(%g,%g,%g)" : ",(%g,%g,%g)", vertex[i * 3 + 0], vertex[i * 3 + 1], vertex[i * 3 + 2]);
+	}
+	append(");\n");
+
+	append("\tnormals=(");
+	for (size_t i = 0; i < vertex_size; i++) {
+		append(i == 0 ? "(%g,%g,%g)" : ",(%g,%g,%g)", normal[i * 3 + 0], normal[i * 3 + 1], normal[i * 3 + 2]);
+	}
+	append(");\n");
+
+	const size_t triangle_size = mesh->index_list.size() / 3;
+	const GLuint* index = mesh->index_list.data();
+
+	append("\tfaces=(");
+	for (size_t i = 0; i < triangle_size; i++) {
+		append(i == 0 ? "(%u,%u,%u)" : ",(%u,%u,%u)", index[i * 3 + 0], index[i * 3 + 1], index[i * 3 + 2]);
+	}
+	append(");\n");
+}
+
+
+// printf into the end of buffer, no temporary string
+// measured first, so a line of any length is written whole
+void ModelRayFile::append(const char* pattern, ...) {
+	va_list args;
+	va_start(args, pattern);
+
+	va_list args_measure;
+	va_copy(args_measure, args);
+	const int length = vsnprintf(nullptr, 0, pattern, args_measure);
+	va_end(args_measure);
+
+	if (length > 0) {
+		// room for the terminator vsnprintf writes, dropped after
+		const size_t offset = buffer.size();
+		buffer.resize(offset + length + 1);
+		vsnprintf(&buffer[offset], length + 1, pattern, args);
+		buffer.resize(offset + length);
+	}
+
+	va_end(args);
+}
@@ -0,0 +1,99 @@
+#ifndef MODELRAYFILE_H
+#define MODELRAYFILE_H
+
+
+#include <FL/gl.h>
+#include <vector>
+#include <string>
+#include "stdint.h"
+#include "vec.h"
+#include "mat.h"
+#include "ModelMesh.h"
+
+
+// one primitive of a .ray scene, with its object to world matrix already resolved
+struct ModelRayPrimitive {
+	enum Type {
+		RAY_SPHERE = 0,		// unit radius, at origin
+		RAY_BOX,			// unit box, centered at origin
+		RAY_MESH			// mesh of ModelMeshCache
+	};
+
+	int32_t				type;
+	Mat4d				matrix;
+	ModelMeshKey		mesh_key = ModelMeshKey(ModelMeshKey::MESH_BOX);
+	const ModelMesh*	mesh = nullptr;
+	GLfloat				diffuse[3];
+	GLfloat				ambient[3];
+};
+
+
+// SBT-raytracer 1.0 scene built from CPU side matrices, without any GL call
+// primitives are collected first (from ModelObject::exportSelf), then the whole file is
+// formatted into one buffer and written at once, so a filled ModelRayFile does not depend
+// on the scene any more and can be saved on another thread
+class ModelRayFile {
+
+// Data
+protected:
+	// camera
+	GLdouble camera_position[3] = { 0, 0.8, 5 };
+	GLdouble camera_direction[3] = { 0, -0.8, -5 };
+	GLdouble camera_up[3] = { 0, 1, 0 };
+	GLdouble camera_fov = 30;
+	GLdouble camera_aspect = 1;
+
+	// material of the primitives added next
+	GLfloat material_diffuse[3] = { 0.5f, 0.5f, 0.5f };
+	GLfloat material_ambient[3] = { 0, 0, 0 };
+
+	// light
+	std::vector<GLfloat> light_list;	// direction xyz, color rgb
+
+	// primitive
+	std::vector<ModelRayPrimitive> primitive_list;
+
+	std::string buffer;
+
+// Operation
+public:
+	ModelRayFile();
+	~ModelRayFile();
+
+	// holds mesh references, not copied
+	ModelRayFile(const ModelRayFile&) = delete;
+	ModelRayFile& operator =(const ModelRayFile&) = delete;
+
+	// clear light and primitive, meshes acquired by addMesh are released
+	// not thread safe (ModelMeshCache)
+	void clear();
+
+	// view is the world to eye matrix (Camera::getViewMatrix), fov in degree
+	void setCamera(const Mat4d& view, GLdouble fov, GLdouble aspect);
+	void addDirectionalLight(const GLfloat* direction, const GLfloat* color);
+
+	// like setDiffuseColor / setAmbientColor, for the primitives added after
+	void setMaterial(const GLfloat* diffuse, const GLfloat* ambient);
+
+	// mat is object to world
+	void addSphere(const Mat4d& mat);
+	void addBox(const Mat4d& mat);
+	void addMesh(const Mat4d& mat, const ModelMeshKey& key);  // mesh is held until clear
+	int32_t size();
+
+	// output
+	// format only reads the collected data, so different files can be saved in parallel
+	const std::string& format();
+	bool save(const char* path);
+
+protected:
+	void addPrimitive(int32_t type, const Mat4d& mat);
+
+	void appendMatrix(const Mat4d& mat);
+	void appendMaterial(const ModelRayPrimitive& primitive);
+	void appendMesh(const ModelRayPrimitive& primitive);
+	void append(const char* pattern, ...);
+};
+
+
+#endif
@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include "modelerdraw.h"
+#include "modelerraster.h"
+#include "ModelObject.h"
+#include "ModelRenderQueue.h"
+
+
+// Static Data
+// lod: diameter in pixel where the level goes up, and how far past it the size has to move
+static const GLdouble LOD_THRESHOLD[3] = { 24, 64, 160 };
+static const GLdouble LOD_HYSTERESIS = 0.2;
+
+
+// Operation Handling
+ModelRenderQueue::ModelRenderQueue() {
+}
+
+
+void ModelRenderQueue::clear() {
+	item_list.clear();
+	material_list.clear();
+	material_map.clear();
+}
+
+
+void ModelRenderQueue::add(ModelObject* node, const Mat4d& mat) {
+	add(node, mat, -1);
+}
+
+
+void ModelRenderQueue::add(ModelObject* node, const Mat4d& mat, int32_t slot) {
+	if (ModelerDrawState::Instance()->m_rayFile != NULL) {
+		addNode(node, mat);
+		return;
+	}
+
+	lod_slot = slot;
+	node->queueSelf(this, mat);
+	lod_slot = -1;
+}
+
+
+void ModelRenderQueue::addMesh(const ModelMesh* mesh, const Mat4d& mat) {
+	if (mesh == nullptr || mesh->index_list.empty()) return;
+
+	ModelRenderItem item;
+	item.mesh = mesh;
+	item.node = nullptr;
+	item.matrix = mat;
+	item.material = addMaterial();
+	item_list.push_back(item);
+}
+
+
+void ModelRenderQueue::addNode(ModelObject* node, const Mat4d& mat) {
+	ModelRenderItem item;
+	item.mesh = nullptr;
+	item.node = node;
+	item.matrix = mat;
+	item.material = addMaterial();
+	item_list.push_back(item);
+}
+
+
+void ModelRenderQueue::submit() {
+	const int32_t size = item_list.size();
+	if (size == 0) return;
+
+	// mesh items by state, node items last and in order
+	order_list.resize(size);
+	for (int32_t i = 0; i < size; i++) order_list[i] = i;
+
+	std::stable_sort(order_list.begin(), order_list.end(), [this](int32_t a, int32_t b) {
+		const ModelRenderItem& item_a = item_list[a];
+		const ModelRenderItem& item_b = item_list[b];
+
+		if ((item_a.mesh == nullptr) != (item_b.mesh == nullptr)) return item_b.mesh == nullptr;
+		if (item_a.mesh == nullptr) return false;
+
+		const int32_t mode_a = material_list[item_a.material].draw_mode;
+		const int32_t mode_b = material_list[item_b.material].draw_mode;
+		if (mode_a != mode_b) return mode_a < mode_b;
+		if (item_a.material != item_b.material) return item_a.material < item_b.material;
+		return item_a.mesh < item_b.mesh;
+	});
+
+	// state the caller had when submitting
+	ModelRenderMaterial saved;
+	Helper_getMaterial(&saved);
+
+	ModelerRaster* raster = ModelerDrawState::Instance()->m_raster;
+	if (raster != NULL) {
+		submitRaster(raster);
+		Helper_setMaterial(saved);
+		clear();
+		return;
+	}
+
+	// every item is loaded as base * matrix, so the base is read back once
+	GLdouble gl_matrix[16];
+	glGetDoublev(GL_MODELVIEW_MATRIX, gl_matrix);
+	Mat4d base(
+		gl_matrix[0], gl_matrix[4], gl_matrix[8], gl_matrix[12],
+		gl_matrix[1], gl_matrix[5], gl_matrix[9], gl_matrix[13],
+		gl_matrix[2], gl_matrix[6], gl_matrix[10], gl_matrix[14],
+		gl_matrix[3], gl_matrix[7], gl_matrix[11], gl_matrix[15]);
+
+	int32_t material = -1;
+	const ModelMesh* mesh = nullptr;
+	bool is_array = false;
+
+	for (int32_t i = 0; i < size; i++) {
+		const ModelRenderItem& item = item_list[order_list[i]];
+
+		if (item.material != material) {
+			material = item.material;
+			Helper_setMaterial(material_list[material]);
+		}
+
+		(base * item.matrix).getGLMatrix(gl_matrix);
+		glLoadMatrixd(gl_matrix);
+
+		// node
+		if (item.mesh == nullptr) {
+			if (is_array) {
+				glDisableClientState(GL_NORMAL_ARRAY);
+				glDisableClientState(GL_VERTEX_ARRAY);
+				is_array = false;
+				mesh = nullptr;
+			}
+			item.node->modelSelf();
+			continue;
+		}
+
+		// mesh, arrays are bound once per run of the same mesh
+		applyDrawState();
+
+		if (!is_array) {
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			is_array = true;
+		}
+
+		if (item.mesh != mesh) {
+			mesh = item.mesh;
+			glVertexPointer(3, GL_FLOAT, 0, mesh->vertex_list.data());
+			glNormalPointer(GL_FLOAT, 0, mesh->normal_list.data());
+		}
+
+		glDrawElements(GL_TRIANGLES, (GLsizei)mesh->index_list.size(), GL_UNSIGNED_INT, mesh->index_list.data());
+	}
+
+	if (is_array) {
+		glDisableClientState(GL_NORMAL_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+	}
+
+	base.getGLMatrix(gl_matrix);
+	glLoadMatrixd(gl_matrix);
+	Helper_setMaterial(saved);
+
+	clear();
+}
+
+
+// same order as GL, matrix is given as the model matrix of the raster
+// node items only reach it through the modelerdraw primitives of modelSelf
+void ModelRenderQueue::submitRaster(ModelerRaster* raster) {
+	int32_t material = -1;
+
+	for (int32_t index : order_list) {
+		const ModelRenderItem& item = item_list[index];
+
+		if (item.material != material) {
+			material = item.material;
+			Helper_setMaterial(material_list[material]);
+		}
+
+		raster->setModel(item.matrix);
+		if (item.mesh == nullptr) item.node->modelSelf();
+		else raster->drawMesh(*item.mesh, Mat4d());
+	}
+
+	raster->setModel(Mat4d());
+}
+
+
+int32_t ModelRenderQueue::size() {
+	return item_list.size();
+}
+
+
+int32_t ModelRenderQueue::getMaterialSize() {
+	return material_list.size();
+}
+
+
+void ModelRenderQueue::setView(const Mat4d& mat, int32_t viewport_height) {
+	view_projection = mat;
+
+	// row 1 maps to clip y, its length is the projection scale since the view is a rotation
+	const GLdouble* n = mat.n;
+	const GLdouble scale = sqrt(n[4] * n[4] + n[5] * n[5] + n[6] * n[6]);
+	view_scale = viewport_height > 0 ? scale * viewport_height / 2 : 0;
+}
+
+
+GLdouble ModelRenderQueue::getScreenSize(const ModelBound& bound) {
+	if (view_scale <= 0) return -1;
+	if (bound.isEmpty()) return 0;
+
+	GLdouble center[3];
+	GLdouble radius = 0;
+	for (int i = 0; i < 3; i++) {
+		center[i] = (bound.lower[i] + bound.upper[i]) / 2;
+		radius += (bound.upper[i] - center[i]) * (bound.upper[i] - center[i]);
+	}
+	radius = sqrt(radius);
+
+	// w is the distance along the view direction, anything reaching the eye is as large as it gets
+	const GLdouble* n = view_projection.n;
+	const GLdouble w = n[12] * center[0] + n[13] * center[1] + n[14] * center[2] + n[15];
+	if (w <= radius) return HUGE_VAL;
+
+	return 2 * radius * view_scale / w;
+}
+
+
+QualitySetting_t ModelRenderQueue::selectQuality(const ModelBound& bound) {
+	const QualitySetting_t quality = ModelerDrawState::Instance()->m_quality;
+
+	const GLdouble size = getScreenSize(bound);
+	if (size < 0) return quality;
+
+	int8_t* slot = nullptr;
+	if (lod_slot >= 0) {
+		if (lod_slot >= (int32_t)lod_list.size()) lod_list.resize(lod_slot + 1, -1);
+		slot = &lod_list[lod_slot];
+	}
+
+	const int32_t level = Helper_selectLevel(size, slot != nullptr ? *slot : -1);
+	if (slot != nullptr) *slot = (int8_t)level;
+
+	// HIGH is 0 and POOR is 3, the global setting is the upper limit
+	const int32_t limit = 3 - (int32_t)quality;
+	return (QualitySetting_t)(3 - (level < limit ? level : limit));
+}
+
+
+// current state of ModelerDrawState, shared with every item of an equal state
+// consecutive items mostly have the same one, so the last material is tried before the map
+int32_t ModelRenderQueue::addMaterial() {
+	ModelRenderMaterial material;
+	Helper_getMaterial(&material);
+
+	const int32_t size = material_list.size();
+	if (size != 0 && material_list[size - 1] == material) return size - 1;
+
+	const auto result = material_map.insert(std::make_pair(material, size));
+	if (!result.second) return result.first->second;
+
+	material_list.push_back(material);
+	return size;
+}
+
+
+// material
+bool ModelRenderMaterial::operator==(const ModelRenderMaterial& other) const {
+	return memcmp(this, &other, sizeof(ModelRenderMaterial)) == 0;
+}
+
+
+// FNV-1a over the bytes
+size_t ModelRenderMaterialHash::operator()(const ModelRenderMaterial& material) const {
+	const uint8_t* data = (const uint8_t*)&material;
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < sizeof(ModelRenderMaterial); i++) hash = (hash ^ data[i]) * 16777619u;
+	return hash;
+}
+
+
+// helper
+int32_t ModelRenderQueue::Helper_selectLevel(GLdouble size, int32_t previous) {
+	int32_t level = 0;
+
+	// no history, plain thresholds
+	if (previous < 0) {
+		while (level < 3 && size > LOD_THRESHOLD[level]) level++;
+		return level;
+	}
+
+	// a threshold has to be passed by the hysteresis margin to change level
+	level = previous > 3 ? 3 : previous;
+	while (level < 3 && size > LOD_THRESHOLD[level] * (1 + LOD_HYSTERESIS)) level++;
+	while (level > 0 && size < LOD_THRESHOLD[level - 1] * (1 - LOD_HYSTERESIS)) level--;
+	return level;
+}
+
+
+void ModelRenderQueue::Helper_getMaterial(ModelRenderMaterial* material) {
+	const ModelerDrawState* state = ModelerDrawState::Instance();
+
+	memset(material, 0, sizeof(ModelRenderMaterial));
+	material->draw_mode = state->m_drawMode;
+	memcpy(material->ambient, state->m_ambientColor, sizeof(material->ambient));
+	memcpy(material->diffuse, state->m_diffuseColor, sizeof(material->diffuse));
+	memcpy(material->specular, state->m_specularColor, sizeof(material->specular));
+	material->shininess = state->m_shininess;
+}
+
+
+// only what differs is set, so a property never set keeps the OpenGL default
+void ModelRenderQueue::Helper_setMaterial(const ModelRenderMaterial& material) {
+	const ModelerDrawState* state = ModelerDrawState::Instance();
+
+	if (state->m_drawMode != material.draw_mode) setDrawMode((DrawModeSetting_t)material.draw_mode);
+
+	if (memcmp(state->m_ambientColor, material.ambient, sizeof(material.ambient)) != 0)
+		setAmbientColor(material.ambient[0], material.ambient[1], material.ambient[2]);
+	if (memcmp(state->m_diffuseColor, material.diffuse, sizeof(material.diffuse)) != 0)
+		setDiffuseColor(material.diffuse[0], material.diffuse[1], material.diffuse[2]);
+	if (memcmp(state->m_specularColor, material.specular, sizeof(material.specular)) != 0)
+		setSpecularColor(material.specular[0], material.specular[1], material.specular[2]);
+	if (state->m_shininess != material.shininess)
+		setShininess(material.shininess);
+}
@@ -0,0 +1,121 @@
+#ifndef MODELRENDERQUEUE_H
+#define MODELRENDERQUEUE_H
+
+
+#include <FL/gl.h>
+#include <vector>
+#include <unordered_map>
+#include "stdint.h"
+#include "vec.h"
+#include "mat.h"
+#include "ModelMesh.h"
+#include "ModelBound.h"
+#include "modelerdraw.h"
+
+
+class ModelObject;
+class ModelerRaster;
+
+
+// draw state of ModelerDrawState an item is drawn with
+struct ModelRenderMaterial {
+	int32_t		draw_mode;
+	GLfloat		ambient[4];
+	GLfloat		diffuse[4];
+	GLfloat		specular[4];
+	GLfloat		shininess;
+
+	// bitwise, every member is 4 bytes so there is no padding
+	bool operator==(const ModelRenderMaterial& other) const;
+};
+
+
+struct ModelRenderMaterialHash {
+	size_t operator()(const ModelRenderMaterial& material) const;
+};
+
+
+// one draw of a frame
+// mesh is drawn with matrix, or node->modelSelf() is called when there is no mesh
+struct ModelRenderItem {
+	const ModelMesh*	mesh;
+	ModelObject*		node;
+	Mat4d				matrix;
+	int32_t				material;	// index in material_list
+};
+
+
+// draws collected over a frame, then submitted at once
+// mesh items are sorted by draw mode, material and mesh, so each state is set once per run
+// and the vertex arrays of a mesh are bound once for all of its instances;
+// node items are drawn after them, in the order they were added
+//
+// with a view set, round primitives pick their tessellation from their size on screen
+// (see selectQuality), never above the quality of ModelerDrawState
+class ModelRenderQueue {
+
+// Data
+protected:
+	std::vector<ModelRenderItem>		item_list;
+	std::vector<ModelRenderMaterial>	material_list;
+	std::unordered_map<ModelRenderMaterial, int32_t, ModelRenderMaterialHash>	material_map;	// index in material_list
+	std::vector<int32_t>				order_list;
+
+	// lod
+	Mat4d		view_projection;
+	GLdouble	view_scale = 0;				// pixel per unit at w = 1, 0 when no view is set
+	int32_t		lod_slot = -1;				// slot of the node being added
+	std::vector<int8_t>	lod_list;			// level of each slot in the last frame, -1 when none
+
+// Operation
+public:
+	ModelRenderQueue();
+
+	void clear();
+
+	// add what node draws, with mat as the world matrix of the node
+	// the node is drawn through modelSelf while a .ray file is open,
+	// since only the modelerdraw functions write it
+	void add(ModelObject* node, const Mat4d& mat);
+
+	// slot identifies the node (or node of an instance) from frame to frame,
+	// so its level only changes once its size has moved clearly past a threshold
+	void add(ModelObject* node, const Mat4d& mat, int32_t slot);
+
+	// mat maps mesh to world, drawn with the current state of ModelerDrawState
+	// mesh has to stay alive until submit
+	void addMesh(const ModelMesh* mesh, const Mat4d& mat);
+	void addNode(ModelObject* node, const Mat4d& mat);
+
+	// draw everything relative to the current GL modelview and clear,
+	// ModelerDrawState is left as it was
+	// with a raster set in ModelerDrawState, the matrices are world matrices of the raster
+	void submit();
+
+	int32_t size();
+	int32_t getMaterialSize();
+
+	// lod
+	// viewport_height is in pixel, 0 clears the view
+	void setView(const Mat4d& view_projection, int32_t viewport_height);
+
+	// diameter in pixel of the sphere around bound (world), -1 when no view is set
+	GLdouble getScreenSize(const ModelBound& bound);
+
+	// quality of the node being added, from the screen size of bound (world)
+	QualitySetting_t selectQuality(const ModelBound& bound);
+
+	// level 0 (POOR) to 3 (HIGH) for size, with hysteresis against previous (-1 for none)
+	static int32_t Helper_selectLevel(GLdouble size, int32_t previous);
+
+protected:
+	int32_t addMaterial();
+	void submitRaster(ModelerRaster* raster);
+
+	// helper
+	static void Helper_getMaterial(ModelRenderMaterial* material);
+	static void Helper_setMaterial(const ModelRenderMaterial& material);
+};
+
+
+#endif
@@ -0,0 +1,245 @@
+#include "ModelRig.h"
+#include "ModelScene.h"
+#include "ModelRenderQueue.h"
+#include "ModelRayFile.h"
+#include "parallel.h"
+
+
+// Static Data
+// instances evaluated by one task of the batched pass
+static const int32_t RIG_BLOCK_SIZE = 64;
+
+
+// Operation Handling
+ModelRig::ModelRig() {
+}
+
+
+void ModelRig::build(ModelObject* root) {
+	ModelScene::Helper_flatten(root, &node_list, &parent_list);
+	node_size = node_list.size();
+	variant_size = 1;
+	updateTemplate();
+
+	// reset instance with the new layout
+	const int32_t size = instance_size;
+	instance_size = 0;
+	variant_list.clear();
+	channel_list.clear();
+	root_list.clear();
+	world_list.clear();
+	setInstanceSize(size);
+}
+
+
+// dimension or attachment of the template changed
+void ModelRig::updateTemplate() {
+	attach_list.resize(node_list.size());
+
+	for (int32_t v = 0; v < variant_size; v++) {
+		ModelObject** nodes = node_list.data() + v * node_size;
+		Mat4d* attachs = attach_list.data() + v * node_size;
+
+		for (int32_t i = 0; i < node_size; i++) {
+			const int32_t parent = parent_list[i];
+			attachs[i] = parent < 0 ? Mat4d() : nodes[parent]->getAttachMatrix(nodes[i]->getAttachIndex());
+		}
+	}
+}
+
+
+int32_t ModelRig::addVariant(ModelObject* root) {
+	if (root == nullptr) return -1;
+
+	std::vector<ModelObject*> nodes;
+	std::vector<int32_t> parents;
+	ModelScene::Helper_flatten(root, &nodes, &parents);
+
+	// same tree, so channels and world matrices line up
+	if (node_size == 0 || parents != parent_list) return -1;
+	for (int32_t i = 0; i < node_size; i++) {
+		if (nodes[i]->getAttachIndex() != node_list[i]->getAttachIndex()) return -1;
+	}
+
+	node_list.insert(node_list.end(), nodes.begin(), nodes.end());
+	variant_size++;
+	updateTemplate();
+	return variant_size - 1;
+}
+
+
+int32_t ModelRig::getVariantSize() {
+	return variant_size;
+}
+
+
+void ModelRig::setVariant(int32_t instance, int32_t variant) {
+	variant_list[instance] = variant;
+}
+
+
+int32_t ModelRig::getVariant(int32_t instance) {
+	return variant_list[instance];
+}
+
+
+void ModelRig::setInstanceSize(int32_t size) {
+	if (size < 0) size = 0;
+
+	const int32_t channel_size = getChannelSize();
+	const int32_t copy_size = size < instance_size ? size : instance_size;
+
+	// rows are re-laid out as the row length is the instance count
+	std::vector<GLdouble> channels(channel_size * size);
+	for (int32_t i = 0; i < node_size; i++) {
+		const GLdouble* origin = node_list[i]->getOrigin();
+		const GLdouble* rotation = node_list[i]->getRotation();
+
+		for (int32_t type = 0; type < CHANNEL_SIZE; type++) {
+			const int32_t channel = i * CHANNEL_SIZE + type;
+			const GLdouble value = type < CHANNEL_ROTATION_X ? origin[type] : rotation[type - CHANNEL_ROTATION_X];
+
+			GLdouble* dst = channels.data() + channel * size;
+			const GLdouble* src = channel_list.data() + channel * instance_size;
+			for (int32_t k = 0; k < copy_size; k++) dst[k] = src[k];
+			for (int32_t k = copy_size; k < size; k++) dst[k] = value;
+		}
+	}
+
+	channel_list.swap(channels);
+	variant_list.resize(size, 0);
+	root_list.resize(size);
+	world_list.assign(node_size * size, Mat4d());
+	instance_size = size;
+}
+
+
+int32_t ModelRig::getInstanceSize() {
+	return instance_size;
+}
+
+
+int32_t ModelRig::getNodeSize() {
+	return node_size;
+}
+
+
+// node of any variant
+int32_t ModelRig::getNodeIndex(ModelObject* node) {
+	for (int32_t i = 0; i < (int32_t)node_list.size(); i++) {
+		if (node_list[i] == node) return i % node_size;
+	}
+	return -1;
+}
+
+
+int32_t ModelRig::getChannelSize() {
+	return node_size * CHANNEL_SIZE;
+}
+
+
+int32_t ModelRig::getChannelIndex(int32_t node, ChannelType type) {
+	return node * CHANNEL_SIZE + type;
+}
+
+
+void ModelRig::setChannel(int32_t instance, int32_t channel, GLdouble value) {
+	channel_list[channel * instance_size + instance] = value;
+}
+
+
+GLdouble ModelRig::getChannel(int32_t instance, int32_t channel) {
+	return channel_list[channel * instance_size + instance];
+}
+
+
+GLdouble* ModelRig::getChannelData(int32_t channel) {
+	return channel_list.data() + channel * instance_size;
+}
+
+
+void ModelRig::setRoot(int32_t instance, const Mat4d& mat) {
+	root_list[instance] = mat;
+}
+
+
+void ModelRig::transform() {
+	const int32_t block_size = (instance_size + RIG_BLOCK_SIZE - 1) / RIG_BLOCK_SIZE;
+
+	// node major inside a block, so each channel row is read contiguously
+	parallelFor(block_size, [&](int block) {
+		const int32_t begin = block * RIG_BLOCK_SIZE;
+		const int32_t end = begin + RIG_BLOCK_SIZE < instance_size ? begin + RIG_BLOCK_SIZE : instance_size;
+
+		for (int32_t i = 0; i < node_size; i++) {
+			const int32_t parent = parent_list[i];
+			const GLdouble* channel = channel_list.data() + i * CHANNEL_SIZE * instance_size;
+			Mat4d* world = world_list.data() + i * instance_size;
+			const Mat4d* world_parent = parent < 0 ? nullptr : world_list.data() + parent * instance_size;
+
+			for (int32_t k = begin; k < end; k++) {
+				GLdouble origin[3];
+				GLdouble rotation[3];
+				for (int32_t j = 0; j < 3; j++) {
+					origin[j] = channel[(CHANNEL_ORIGIN_X + j) * instance_size + k];
+					rotation[j] = channel[(CHANNEL_ROTATION_X + j) * instance_size + k];
+				}
+
+				const Mat4d& attach = attach_list[variant_list[k] * node_size + i];
+				const Mat4d local = attach * ModelObject::Helper_getMatrix(origin, rotation);
+				world[k] = (parent < 0 ? root_list[k] : world_parent[k]) * local;
+			}
+		}
+	});
+}
+
+
+// every instance in one queue, so each mesh is bound once for the whole crowd
+void ModelRig::draw() {
+	render_queue.setView(Mat4d(), 0);
+	for (int32_t k = 0; k < instance_size; k++) queue(k);
+	render_queue.submit();
+}
+
+
+void ModelRig::draw(int32_t instance) {
+	render_queue.setView(Mat4d(), 0);
+	queue(instance);
+	render_queue.submit();
+}
+
+
+void ModelRig::draw(const Mat4d& view_projection, int32_t viewport_height) {
+	render_queue.setView(view_projection, viewport_height);
+	for (int32_t k = 0; k < instance_size; k++) queue(k);
+	render_queue.submit();
+}
+
+
+// slot is the index in world_list, so each instance keeps its own level
+void ModelRig::queue(int32_t instance) {
+	ModelObject** nodes = node_list.data() + variant_list[instance] * node_size;
+
+	for (int32_t i = 0; i < node_size; i++) {
+		const int32_t index = i * instance_size + instance;
+		render_queue.add(nodes[i], world_list[index], index);
+	}
+}
+
+
+void ModelRig::exportRay(ModelRayFile* file) {
+	for (int32_t k = 0; k < instance_size; k++) {
+		ModelObject** nodes = node_list.data() + variant_list[k] * node_size;
+		for (int32_t i = 0; i < node_size; i++) nodes[i]->exportSelf(file, world_list[i * instance_size + k]);
+	}
+}
+
+
+ModelObject* ModelRig::getNode(int32_t variant, int32_t node) {
+	return node_list[variant * node_size + node];
+}
+
+
+const Mat4d& ModelRig::getWorld(int32_t instance, int32_t node) {
+	return world_list[node * instance_size + instance];
+}
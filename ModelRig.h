@@ -0,0 +1,116 @@
+#ifndef MODELRIG_H
+#define MODELRIG_H
+
+
+#include <vector>
+#include "stdint.h"
+#include "vec.h"
+#include "mat.h"
+#include "ModelObject.h"
+#include "ModelRenderQueue.h"
+
+
+class ModelRayFile;
+
+
+// many instances of one ModelObject tree
+// the template supplies geometry, dimension and attachments and is never written to;
+// each instance only owns the animated channels (origin and rotation of every node)
+//
+// shape varies by variant: more templates of the same layout (same tree, their own
+// dimension, attachment and primitive parameters such as the torus), each instance
+// drawn with one of them; variant 0 is the template given to build
+//
+// channels are stored SoA: channel c of every instance is one contiguous row,
+// value of instance k at getChannelData(c)[k]
+// channel index of a node is node * CHANNEL_SIZE + type
+class ModelRig {
+
+// Enum
+public:
+	enum ChannelType {
+		CHANNEL_ORIGIN_X = 0,
+		CHANNEL_ORIGIN_Y,
+		CHANNEL_ORIGIN_Z,
+		CHANNEL_ROTATION_X,
+		CHANNEL_ROTATION_Y,
+		CHANNEL_ROTATION_Z,
+		CHANNEL_SIZE
+	};
+
+// Data
+protected:
+	// template
+	int32_t node_size = 0;
+	int32_t variant_size = 0;
+	std::vector<ModelObject*>	node_list;		// [variant][node]
+	std::vector<int32_t>		parent_list;	// -1 for root
+	std::vector<Mat4d>			attach_list;	// [variant][node], attachment on the parent, identity for root
+
+	// instance
+	int32_t instance_size = 0;
+	std::vector<int32_t>	variant_list;	// [instance]
+	std::vector<GLdouble>	channel_list;	// [channel][instance]
+	std::vector<Mat4d>		root_list;		// [instance]
+	std::vector<Mat4d>		world_list;		// [node][instance]
+
+	ModelRenderQueue render_queue;
+
+// Operation
+public:
+	ModelRig();
+
+	// template
+	// build drops the variants added before
+	void build(ModelObject* root);
+	void updateTemplate();
+
+	// variant
+	// index of the new variant, -1 when the layout of root differs from the template
+	int32_t addVariant(ModelObject* root);
+	int32_t getVariantSize();
+	void setVariant(int32_t instance, int32_t variant);
+	int32_t getVariant(int32_t instance);
+
+	// instance
+	// new instances start with the channel values of the template, in variant 0
+	void setInstanceSize(int32_t size);
+	int32_t getInstanceSize();
+
+	// channel
+	int32_t getNodeSize();
+	int32_t getNodeIndex(ModelObject* node);
+	int32_t getChannelSize();
+	int32_t getChannelIndex(int32_t node, ChannelType type);
+
+	void setChannel(int32_t instance, int32_t channel, GLdouble value);
+	GLdouble getChannel(int32_t instance, int32_t channel);
+	GLdouble* getChannelData(int32_t channel);
+
+	// root
+	void setRoot(int32_t instance, const Mat4d& mat);
+
+	// evaluate
+	// every instance in one batched pass, spread over the hardware threads
+	void transform();
+
+	// draw
+	// view_projection maps the frame of the roots to clip space, primitives are
+	// tessellated for their size on screen with the viewport height (pixel)
+	void draw();
+	void draw(int32_t instance);
+	void draw(const Mat4d& view_projection, int32_t viewport_height);
+
+	// export
+	void exportRay(ModelRayFile* file);
+
+	// get
+	ModelObject* getNode(int32_t variant, int32_t node);
+	const Mat4d& getWorld(int32_t instance, int32_t node);
+
+protected:
+	void queue(int32_t instance);
+};
+
+
+#endif
@@ -0,0 +1,273 @@
+#include "ModelScene.h"
+#include "parallel.h"
+
+
+// Static Data
+// subtree smaller than this is one range, the task overhead would outweigh the work
+static const int32_t PARALLEL_SUBTREE_SIZE = 64;
+
+
+// Operation Handling
+ModelScene::ModelScene() {
+}
+
+
+ModelScene::~ModelScene() {
+	clear();
+}
+
+
+void ModelScene::build(ModelObject* root) {
+	clear();
+	if (root == nullptr) return;
+
+	Helper_flatten(root, &node_list, &parent_list);
+
+	const size_t size = node_list.size();
+
+	// parent comes before its descendants, so walk backward to carry subtree end upward
+	end_list.resize(size);
+	for (int32_t i = 0; i < (int32_t)size; i++) end_list[i] = i + 1;
+	for (int32_t i = (int32_t)size - 1; i > 0; i--) {
+		const int32_t parent = parent_list[i];
+		if (end_list[i] > end_list[parent]) end_list[parent] = end_list[i];
+	}
+
+	local_list.resize(size);
+	world_list.resize(size);
+	dirty_list.assign(size, 1);
+	changed_list.assign(size, 0);
+	bound_list.assign(size, ModelBound());
+	subtree_bound_list.assign(size, ModelBound());
+
+	for (int32_t i = 0; i < (int32_t)size; i++) node_list[i]->setScene(this, i);
+}
+
+
+void ModelScene::clear() {
+	for (ModelObject* node : node_list) node->setScene(nullptr, -1);
+
+	node_list.clear();
+	parent_list.clear();
+	end_list.clear();
+	local_list.clear();
+	world_list.clear();
+	dirty_list.clear();
+	changed_list.clear();
+	bound_list.clear();
+	subtree_bound_list.clear();
+}
+
+
+void ModelScene::invalidate(int32_t index) {
+	dirty_list[index] = 1;
+}
+
+
+void ModelScene::invalidateAll() {
+	for (size_t i = 0; i < dirty_list.size(); i++) dirty_list[i] = 1;
+}
+
+
+void ModelScene::setRoot(const Mat4d& mat) {
+	if (mat == root_matrix) return;
+	root_matrix = mat;
+	if (!dirty_list.empty()) dirty_list[0] = 1;
+}
+
+
+void ModelScene::transform() {
+	const int32_t size = node_list.size();
+	bool is_changed = false;
+
+	// a large subtree is split at its root: the root is evaluated here, its child subtrees are
+	// separate ranges; ranges only read parents inside them or evaluated before, so they run in parallel
+	std::vector<int32_t> range_list;
+	std::vector<int32_t> split_list;
+	if (size > 0) split_list.push_back(0);
+
+	while (!split_list.empty()) {
+		const int32_t index = split_list.back();
+		split_list.pop_back();
+
+		if (end_list[index] - index < PARALLEL_SUBTREE_SIZE) {
+			range_list.push_back(index);
+			continue;
+		}
+
+		if (transformNode(index)) is_changed = true;
+
+		// resolve the attachments of the root here, so the ranges below only read them
+		if (index + 1 < end_list[index]) node_list[index]->getAttachMatrix(node_list[index + 1]->getAttachIndex());
+		for (int32_t child = index + 1; child < end_list[index]; child = end_list[child]) split_list.push_back(child);
+	}
+
+	std::vector<uint8_t> range_changed(range_list.size(), 0);
+	parallelFor(range_list.size(), [&](int i) {
+		const int32_t begin = range_list[i];
+		for (int32_t j = begin; j < end_list[begin]; j++) {
+			if (transformNode(j)) range_changed[i] = 1;
+		}
+	});
+	for (size_t i = 0; i < range_changed.size(); i++) {
+		if (range_changed[i]) is_changed = true;
+	}
+
+	for (int32_t i = 0; i < size; i++) dirty_list[i] = 0;
+
+	// subtree bound, children are merged into the parent walking backward
+	if (!is_changed) return;
+	for (int32_t i = 0; i < size; i++) subtree_bound_list[i] = bound_list[i];
+	for (int32_t i = size - 1; i > 0; i--) subtree_bound_list[parent_list[i]].merge(subtree_bound_list[i]);
+}
+
+
+// true when the world matrix is recomputed, the parent must be done before
+bool ModelScene::transformNode(int32_t index) {
+	const int32_t parent = parent_list[index];
+
+	// the attachment depends on the parent's dimension,
+	// so a dirty parent also refreshes the local matrix of its children
+	if (dirty_list[index] || (parent >= 0 && dirty_list[parent])) {
+		local_list[index] = node_list[index]->getLocalMatrix();
+		if (parent >= 0) local_list[index] = node_list[parent]->getAttachMatrix(node_list[index]->getAttachIndex()) * local_list[index];
+	}
+
+	changed_list[index] = dirty_list[index] || (parent >= 0 && changed_list[parent]);
+	if (!changed_list[index]) return false;
+
+	world_list[index] = (parent >= 0 ? world_list[parent] : root_matrix) * local_list[index];
+	node_list[index]->setMatrix(world_list[index]);
+	bound_list[index] = node_list[index]->getLocalBound().transform(world_list[index]);
+	return true;
+}
+
+
+void ModelScene::draw() {
+	render_queue.setView(Mat4d(), 0);
+	for (int32_t i = 0; i < (int32_t)node_list.size(); i++) render_queue.add(node_list[i], world_list[i], i);
+	render_queue.submit();
+
+	draw_count = node_list.size();
+}
+
+
+void ModelScene::draw(const Mat4d& view_projection, int32_t viewport_height) {
+	ModelFrustum frustum;
+	frustum.set(view_projection);
+	render_queue.setView(view_projection, viewport_height);
+
+	const int32_t size = node_list.size();
+	int32_t inside_end = 0;		// nodes before this index lie in a subtree fully inside
+	draw_count = 0;
+
+	for (int32_t i = 0; i < size; i++) {
+		if (i >= inside_end) {
+			const ModelFrustum::Result result = frustum.test(subtree_bound_list[i]);
+
+			// skip the whole subtree
+			if (result == ModelFrustum::OUTSIDE) {
+				i = end_list[i] - 1;
+				continue;
+			}
+
+			// no more test needed for this subtree
+			if (result == ModelFrustum::INSIDE) {
+				inside_end = end_list[i];
+			}
+
+			// the subtree is partly visible, the node itself may still be outside
+			else if (frustum.test(bound_list[i]) == ModelFrustum::OUTSIDE) {
+				continue;
+			}
+		}
+
+		if (bound_list[i].isEmpty()) continue;
+
+		render_queue.add(node_list[i], world_list[i], i);
+		draw_count++;
+	}
+
+	render_queue.submit();
+}
+
+
+void ModelScene::exportRay(ModelRayFile* file) {
+	for (int32_t i = 0; i < (int32_t)node_list.size(); i++) node_list[i]->exportSelf(file, world_list[i]);
+}
+
+
+int32_t ModelScene::getDrawCount() {
+	return draw_count;
+}
+
+
+int32_t ModelScene::size() {
+	return node_list.size();
+}
+
+
+ModelObject* ModelScene::getNode(int32_t index) {
+	return node_list[index];
+}
+
+
+int32_t ModelScene::getParent(int32_t index) {
+	return parent_list[index];
+}
+
+
+const Mat4d& ModelScene::getWorld(int32_t index) {
+	return world_list[index];
+}
+
+
+bool ModelScene::isChanged(int32_t index) {
+	return changed_list[index] != 0;
+}
+
+
+int32_t ModelScene::getSubtreeEnd(int32_t index) {
+	return end_list[index];
+}
+
+
+const ModelBound& ModelScene::getBound(int32_t index) {
+	return bound_list[index];
+}
+
+
+const ModelBound& ModelScene::getSubtreeBound(int32_t index) {
+	return subtree_bound_list[index];
+}
+
+
+void ModelScene::Helper_flatten(ModelObject* root, std::vector<ModelObject*>* nodes, std::vector<int32_t>* parents) {
+	nodes->clear();
+	parents->clear();
+	if (root == nullptr) return;
+
+	// depth first, pre-order, so every subtree is one contiguous range
+	std::vector<ModelObject*> node_stack;
+	std::vector<int32_t> parent_stack;
+	node_stack.push_back(root);
+	parent_stack.push_back(-1);
+
+	while (!node_stack.empty()) {
+		ModelObject* node = node_stack.back();
+		const int32_t parent = parent_stack.back();
+		node_stack.pop_back();
+		parent_stack.pop_back();
+
+		const int32_t index = nodes->size();
+		nodes->push_back(node);
+		parents->push_back(parent);
+
+		// reversed, so the first child is visited first
+		std::vector<ModelObject*>* children = node->getChildren();
+		for (int32_t i = (int32_t)children->size() - 1; i >= 0; i--) {
+			node_stack.push_back((*children)[i]);
+			parent_stack.push_back(index);
+		}
+	}
+}
@@ -0,0 +1,91 @@
+#ifndef MODELSCENE_H
+#define MODELSCENE_H
+
+
+#include <vector>
+#include "stdint.h"
+#include "vec.h"
+#include "mat.h"
+#include "ModelObject.h"
+#include "ModelBound.h"
+#include "ModelRayFile.h"
+#include "ModelRenderQueue.h"
+
+
+// flattened ModelObject tree
+// nodes are stored depth first, parent before child, so one linear pass evaluates every world matrix
+// and the subtree of node i is the range [i, end of i)
+// only nodes that are dirty, or below a dirty node, are recomputed
+class ModelScene {
+
+// Data
+protected:
+	std::vector<ModelObject*>	node_list;
+	std::vector<int32_t>		parent_list;	// -1 for root
+	std::vector<int32_t>		end_list;		// one past the last node of the subtree
+	std::vector<Mat4d>			local_list;		// parent attachment * own translation and rotation
+	std::vector<Mat4d>			world_list;
+	std::vector<uint8_t>		dirty_list;
+	std::vector<uint8_t>		changed_list;	// world matrix recomputed in the last pass
+
+	// bound, in the same frame as the world matrix
+	std::vector<ModelBound>		bound_list;			// what the node itself draws
+	std::vector<ModelBound>		subtree_bound_list;	// node and every descendant
+	int32_t draw_count = 0;
+
+	// draws of a frame, sorted by state on submit
+	ModelRenderQueue render_queue;
+
+	Mat4d root_matrix;
+
+// Operation
+public:
+	ModelScene();
+	~ModelScene();
+
+	// build
+	void build(ModelObject* root);
+	void clear();
+
+	// dirty
+	void invalidate(int32_t index);
+	void invalidateAll();
+
+	// evaluate
+	// mat is the frame the root is attached to
+	// subtrees of at least PARALLEL_SUBTREE_SIZE nodes are split, their child subtrees evaluated in parallel
+	void setRoot(const Mat4d& mat);
+	void transform();
+
+	// draw
+	// view_projection maps the frame of the root matrix to clip space,
+	// subtrees outside of it are skipped without visiting their nodes;
+	// with the viewport height (pixel), primitives are tessellated for their size on screen
+	void draw();
+	void draw(const Mat4d& view_projection, int32_t viewport_height = 0);
+	int32_t getDrawCount();
+
+	// export
+	// every node with its evaluated world matrix, no GL call
+	void exportRay(ModelRayFile* file);
+
+	// get
+	int32_t size();
+	ModelObject* getNode(int32_t index);
+	int32_t getParent(int32_t index);
+	const Mat4d& getWorld(int32_t index);
+	bool isChanged(int32_t index);
+	int32_t getSubtreeEnd(int32_t index);
+	const ModelBound& getBound(int32_t index);
+	const ModelBound& getSubtreeBound(int32_t index);
+
+	// helper
+	// flatten the tree under root, depth first, parent before child
+	static void Helper_flatten(ModelObject* root, std::vector<ModelObject*>* nodes, std::vector<int32_t>* parents);
+
+protected:
+	bool transformNode(int32_t index);
+};
+
+
+#endif
@@ -0,0 +1,465 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+#include "ModelSceneFile.h"
+#include "ModelScene.h"
+#include "ModelObject_Box.h"
+#include "ModelObject_Sphere.h"
+#include "ModelObject_Cylinder.h"
+#include "ModelObject_Prism.h"
+#include "ModelObject_Torus.h"
+
+
+// Static Data
+static const char		SCENE_MAGIC[4]	= { 'A', 'S', 'C', 'N' };
+static const uint32_t	SCENE_VERSION	= 1;
+
+static const char* NODE_TYPE_NAME[] = { "box", "sphere", "cylinder", "prism", "torus" };
+static const char* CONTROL_TYPE_NAME[] = { "self", "dimension", "rotation", "origin" };
+
+
+// Static Function Prototype
+static const char* Helper_mapFile(const char* path, size_t* size, void** handle);
+static void Helper_unmapFile(const char* data, size_t size, void* handle);
+static int Helper_findName(const char** names, int size, const std::string& name);
+static ModelObject* Helper_createNode(ModelArena* arena, uint32_t type);
+
+
+// Operation Handling
+ModelSceneFile::ModelSceneFile() {
+}
+
+
+bool ModelSceneFile::load(const char* path) {
+	clear();
+
+	size_t size = 0;
+	void* handle = nullptr;
+	const char* data = Helper_mapFile(path, &size, &handle);
+	if (data == nullptr) return fail("cannot open file");
+
+	bool result;
+	if (size >= sizeof(SCENE_MAGIC) && memcmp(data, SCENE_MAGIC, sizeof(SCENE_MAGIC)) == 0) {
+		result = parseBinary(data, size);
+	} else {
+		result = parseText(data, size);
+	}
+	Helper_unmapFile(data, size, handle);
+
+	if (!result || !validate() || !instantiate()) {
+		node_list.clear();
+		arena.clear();
+		return false;
+	}
+	return true;
+}
+
+
+bool ModelSceneFile::saveBinary(const char* path) {
+	FILE* file = fopen(path, "wb");
+	if (file == nullptr) return fail("cannot create file");
+
+	Header header;
+	memcpy(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+	header.version = SCENE_VERSION;
+	header.node_size = record_list.size();
+	header.control_size = control_record_list.size();
+	header.string_size = string_list.size();
+	header.reserved = 0;
+
+	fwrite(&header, sizeof(Header), 1, file);
+	if (!record_list.empty()) fwrite(record_list.data(), sizeof(NodeRecord), record_list.size(), file);
+	if (!control_record_list.empty()) fwrite(control_record_list.data(), sizeof(ControlRecord), control_record_list.size(), file);
+	if (!string_list.empty()) fwrite(string_list.data(), 1, string_list.size(), file);
+
+	const bool result = ferror(file) == 0;
+	fclose(file);
+	return result ? true : fail("cannot write file");
+}
+
+
+bool ModelSceneFile::saveText(const char* path) {
+	FILE* file = fopen(path, "w");
+	if (file == nullptr) return fail("cannot create file");
+
+	for (const NodeRecord& record : record_list) {
+		fprintf(file, "node %s %s %s %u\n",
+			NODE_TYPE_NAME[record.type],
+			&string_list[record.name_offset],
+			record.parent < 0 ? "-" : &string_list[record_list[record.parent].name_offset],
+			record.attach_index);
+		fprintf(file, "dimension %g %g %g\n", record.dimension[0], record.dimension[1], record.dimension[2]);
+		fprintf(file, "origin %g %g %g\n", record.origin[0], record.origin[1], record.origin[2]);
+		fprintf(file, "rotation %g %g %g\n", record.rotation[0], record.rotation[1], record.rotation[2]);
+
+		for (uint32_t i = 0; i < record.control_size; i++) {
+			const ControlRecord& control = control_record_list[record.control_begin + i];
+			if (control.type == CONTROL_SELF) {
+				fprintf(file, "control self\n");
+			} else {
+				fprintf(file, "control %s %g %g\n", CONTROL_TYPE_NAME[control.type], control.limit[0], control.limit[1]);
+			}
+		}
+		fprintf(file, "\n");
+	}
+
+	const bool result = ferror(file) == 0;
+	fclose(file);
+	return result ? true : fail("cannot write file");
+}
+
+
+void ModelSceneFile::clear() {
+	record_list.clear();
+	control_record_list.clear();
+	string_list.clear();
+	node_list.clear();
+	arena.clear();
+	error.clear();
+}
+
+
+const char* ModelSceneFile::getError() {
+	return error.c_str();
+}
+
+
+ModelArena* ModelSceneFile::getArena() {
+	return &arena;
+}
+
+
+int32_t ModelSceneFile::size() {
+	return node_list.size();
+}
+
+
+ModelObject* ModelSceneFile::getRoot() {
+	return node_list.empty() ? nullptr : node_list[0];
+}
+
+
+ModelObject* ModelSceneFile::getNode(int32_t index) {
+	return node_list[index];
+}
+
+
+ModelObject* ModelSceneFile::find(const char* name) {
+	for (int32_t i = 0; i < (int32_t)node_list.size(); i++) {
+		if (strcmp(&string_list[record_list[i].name_offset], name) == 0) return node_list[i];
+	}
+	return nullptr;
+}
+
+
+void ModelSceneFile::control(ModelObject* root, std::vector<ModelControl*>* controls) {
+	// only the nodes this file created, other nodes under root (particle systems,
+	// code-built parts) outlive clear() and keep their controls on the heap
+	for (ModelObject* node : node_list) node->setArena(&arena);
+
+	std::unordered_map<ModelObject*, int32_t> record_map;
+	for (int32_t i = 0; i < (int32_t)node_list.size(); i++) record_map[node_list[i]] = i;
+
+	// same order as ModelObject::control: self first, then children in the order they were added
+	std::vector<ModelObject*> nodes;
+	std::vector<int32_t> parents;
+	ModelScene::Helper_flatten(root, &nodes, &parents);
+
+	for (ModelObject* node : nodes) {
+		auto it = record_map.find(node);
+		if (it == record_map.end() || record_list[it->second].control_size == 0) {
+			node->controlSelf(controls);
+			continue;
+		}
+
+		const NodeRecord& record = record_list[it->second];
+		for (uint32_t i = 0; i < record.control_size; i++) {
+			const ControlRecord& control = control_record_list[record.control_begin + i];
+			switch (control.type) {
+			case CONTROL_SELF:
+				node->controlSelf(controls);
+				break;
+			case CONTROL_DIMENSION:
+				ModelObject::Helper_addControl_dimension(node, controls, control.limit[0], control.limit[1]);
+				break;
+			case CONTROL_ROTATION:
+				ModelObject::Helper_addControl_rotation(node, controls, control.limit[0], control.limit[1]);
+				break;
+			case CONTROL_ORIGIN:
+				ModelObject::Helper_addControl_origin(node, controls, control.limit[0], control.limit[1]);
+				break;
+			}
+		}
+	}
+}
+
+
+bool ModelSceneFile::parseText(const char* data, size_t size) {
+	std::unordered_map<std::string, int32_t> name_map;
+	std::vector<std::string> tokens;
+	int line = 0;
+
+	const char* p = data;
+	const char* end = data + size;
+
+	while (p < end) {
+		// split one line into tokens
+		const char* line_end = (const char*)memchr(p, '\n', end - p);
+		if (line_end == nullptr) line_end = end;
+		line++;
+
+		tokens.clear();
+		for (const char* q = p; q < line_end;) {
+			while (q < line_end && (*q == ' ' || *q == '\t' || *q == '\r')) q++;
+			if (q >= line_end || *q == '#') break;
+			const char* token = q;
+			while (q < line_end && *q != ' ' && *q != '\t' && *q != '\r') q++;
+			tokens.push_back(std::string(token, q - token));
+		}
+		p = line_end + 1;
+		if (tokens.empty()) continue;
+
+		char message[128];
+		snprintf(message, sizeof(message), "line %d: invalid statement", line);
+
+		const std::string& key = tokens[0];
+		if (key == "node") {
+			if (tokens.size() != 5) return fail(message);
+
+			NodeRecord record;
+			memset(&record, 0, sizeof(NodeRecord));
+
+			const int type = Helper_findName(NODE_TYPE_NAME, NODE_TYPE_SIZE, tokens[1]);
+			if (type < 0) return fail(message);
+			if (name_map.find(tokens[2]) != name_map.end()) return fail(message);
+
+			record.type = type;
+			record.attach_index = (uint32_t)strtoul(tokens[4].c_str(), nullptr, 10);
+			record.parent = -1;
+			if (tokens[3] != "-") {
+				auto it = name_map.find(tokens[3]);
+				if (it == name_map.end()) return fail(message);
+				record.parent = it->second;
+			}
+
+			record.name_offset = string_list.size();
+			string_list.insert(string_list.end(), tokens[2].begin(), tokens[2].end());
+			string_list.push_back('\0');
+
+			record.dimension[0] = record.dimension[1] = record.dimension[2] = 1;
+			record.control_begin = control_record_list.size();
+
+			name_map[tokens[2]] = record_list.size();
+			record_list.push_back(record);
+			continue;
+		}
+
+		if (record_list.empty()) return fail(message);
+		NodeRecord& record = record_list.back();
+
+		if (key == "dimension" || key == "origin" || key == "rotation") {
+			if (tokens.size() != 4) return fail(message);
+			double* value =
+				key == "dimension"	? record.dimension :
+				key == "origin"		? record.origin : record.rotation;
+			for (int i = 0; i < 3; i++) value[i] = strtod(tokens[i + 1].c_str(), nullptr);
+		}
+
+		else if (key == "control") {
+			const int type = tokens.size() >= 2 ? Helper_findName(CONTROL_TYPE_NAME, CONTROL_TYPE_SIZE, tokens[1]) : -1;
+			if (type < 0) return fail(message);
+			if ((type == CONTROL_SELF) != (tokens.size() == 2)) return fail(message);
+			if (type != CONTROL_SELF && tokens.size() != 4) return fail(message);
+
+			ControlRecord control;
+			control.type = type;
+			control.reserved = 0;
+			control.limit[0] = type == CONTROL_SELF ? 0 : strtod(tokens[2].c_str(), nullptr);
+			control.limit[1] = type == CONTROL_SELF ? 0 : strtod(tokens[3].c_str(), nullptr);
+
+			control_record_list.push_back(control);
+			record.control_size++;
+		}
+
+		else {
+			return fail(message);
+		}
+	}
+
+	return true;
+}
+
+
+// records are copied out of the mapping as they are, no per field parsing
+bool ModelSceneFile::parseBinary(const char* data, size_t size) {
+	if (size < sizeof(Header)) return fail("truncated header");
+
+	Header header;
+	memcpy(&header, data, sizeof(Header));
+	if (header.version != SCENE_VERSION) return fail("unsupported version");
+
+	const size_t node_bytes = (size_t)header.node_size * sizeof(NodeRecord);
+	const size_t control_bytes = (size_t)header.control_size * sizeof(ControlRecord);
+	if (size < sizeof(Header) + node_bytes + control_bytes + header.string_size) return fail("truncated file");
+
+	const char* p = data + sizeof(Header);
+	record_list.resize(header.node_size);
+	control_record_list.resize(header.control_size);
+	string_list.resize(header.string_size);
+
+	if (node_bytes != 0) memcpy(record_list.data(), p, node_bytes);
+	p += node_bytes;
+	if (control_bytes != 0) memcpy(control_record_list.data(), p, control_bytes);
+	p += control_bytes;
+	if (header.string_size != 0) memcpy(string_list.data(), p, header.string_size);
+
+	return true;
+}
+
+
+bool ModelSceneFile::validate() {
+	if (record_list.empty()) return fail("no node");
+	if (string_list.empty() || string_list.back() != '\0') return fail("invalid string table");
+
+	for (int32_t i = 0; i < (int32_t)record_list.size(); i++) {
+		const NodeRecord& record = record_list[i];
+		if (record.type >= NODE_TYPE_SIZE) return fail("invalid node type");
+		if ((i == 0) != (record.parent < 0)) return fail("scene must have exactly one root, listed first");
+		if (record.parent >= i) return fail("parent must be listed before child");
+		if (record.name_offset >= string_list.size()) return fail("invalid node name");
+		if ((uint64_t)record.control_begin + record.control_size > control_record_list.size()) return fail("invalid control range");
+
+		for (uint32_t j = 0; j < record.control_size; j++) {
+			if (control_record_list[record.control_begin + j].type >= CONTROL_TYPE_SIZE) return fail("invalid control type");
+		}
+	}
+	return true;
+}
+
+
+// every node and the name table come from a single arena block
+bool ModelSceneFile::instantiate() {
+	static const size_t node_bytes[NODE_TYPE_SIZE] = {
+		sizeof(ModelObject_Box),
+		sizeof(ModelObject_Sphere),
+		sizeof(ModelObject_Cylinder),
+		sizeof(ModelObject_Prism),
+		sizeof(ModelObject_Torus)
+	};
+
+	size_t total = string_list.size();
+	for (const NodeRecord& record : record_list) total += node_bytes[record.type] + alignof(double) * 2;
+	arena.reserve(total);
+
+	char* names = (char*)arena.allocate(string_list.size(), 1);
+	memcpy(names, string_list.data(), string_list.size());
+
+	node_list.resize(record_list.size());
+	for (size_t i = 0; i < record_list.size(); i++) {
+		const NodeRecord& record = record_list[i];
+
+		ModelObject* node = Helper_createNode(&arena, record.type);
+		node->setName(names + record.name_offset);
+		node->setDimension(record.dimension[0], record.dimension[1], record.dimension[2]);
+		node->setOrigin(record.origin[0], record.origin[1], record.origin[2]);
+		node->setRotation(record.rotation[0], record.rotation[1], record.rotation[2]);
+		node_list[i] = node;
+
+		if (record.parent >= 0 && !node_list[record.parent]->add(node, record.attach_index)) {
+			return fail("invalid attach index");
+		}
+	}
+	return true;
+}
+
+
+bool ModelSceneFile::fail(const char* message) {
+	error = message;
+	return false;
+}
+
+
+// Static Function Implementation
+static const char* Helper_mapFile(const char* path, size_t* size, void** handle) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(file);
+		return nullptr;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) return nullptr;
+
+	const char* data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr) {
+		CloseHandle(mapping);
+		return nullptr;
+	}
+
+	*size = (size_t)file_size.QuadPart;
+	*handle = mapping;
+	return data;
+#else
+	const int file = open(path, O_RDONLY);
+	if (file < 0) return nullptr;
+
+	struct stat file_stat;
+	if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0) {
+		close(file);
+		return nullptr;
+	}
+
+	void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (data == MAP_FAILED) return nullptr;
+
+	*size = file_stat.st_size;
+	*handle = nullptr;
+	return (const char*)data;
+#endif
+}
+
+
+static void Helper_unmapFile(const char* data, size_t size, void* handle) {
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE)handle);
+#else
+	munmap((void*)data, size);
+#endif
+}
+
+
+static int Helper_findName(const char** names, int size, const std::string& name) {
+	for (int i = 0; i < size; i++) {
+		if (name == names[i]) return i;
+	}
+	return -1;
+}
+
+
+static ModelObject* Helper_createNode(ModelArena* arena, uint32_t type) {
+	switch (type) {
+	case ModelSceneFile::NODE_BOX:		return arena->create<ModelObject_Box>();
+	case ModelSceneFile::NODE_SPHERE:	return arena->create<ModelObject_Sphere>();
+	case ModelSceneFile::NODE_CYLINDER:	return arena->create<ModelObject_Cylinder>();
+	case ModelSceneFile::NODE_PRISM:	return arena->create<ModelObject_Prism>();
+	case ModelSceneFile::NODE_TORUS:	return arena->create<ModelObject_Torus>();
+	}
+	return nullptr;
+}
@@ -0,0 +1,124 @@
+#ifndef MODELSCENEFILE_H
+#define MODELSCENEFILE_H
+
+
+#include <vector>
+#include <string>
+#include "stdint.h"
+#include "ModelObject.h"
+#include "ModelArena.h"
+
+
+// scene description, loaded from a file instead of built in code
+//
+// text format, one statement per line, '#' starts a comment
+//   node <box|sphere|cylinder|prism|torus> <name> <parent name or -> <attach index>
+//   dimension <x> <y> <z>
+//   origin <x> <y> <z>
+//   rotation <x> <y> <z>
+//   control <self|dimension|rotation|origin> [min max]
+// dimension / origin / rotation / control apply to the last node
+// a node without control statement uses its own controlSelf
+// parent must be declared before child; nodes are listed depth first,
+// so the control order matches ModelObject::control
+//
+// binary format, little endian
+//   Header, NodeRecord[node_size], ControlRecord[control_size], char[string_size]
+class ModelSceneFile {
+
+// Enum
+public:
+	enum NodeType {
+		NODE_BOX = 0,
+		NODE_SPHERE,
+		NODE_CYLINDER,
+		NODE_PRISM,
+		NODE_TORUS,
+		NODE_TYPE_SIZE
+	};
+
+	enum ControlType {
+		CONTROL_SELF = 0,
+		CONTROL_DIMENSION,
+		CONTROL_ROTATION,
+		CONTROL_ORIGIN,
+		CONTROL_TYPE_SIZE
+	};
+
+// Struct
+public:
+	struct Header {
+		char		magic[4];		// SCENE_MAGIC
+		uint32_t	version;
+		uint32_t	node_size;
+		uint32_t	control_size;
+		uint32_t	string_size;
+		uint32_t	reserved;
+	};
+
+	struct NodeRecord {
+		uint32_t	type;
+		int32_t		parent;			// index of an earlier node, -1 for root
+		uint32_t	attach_index;
+		uint32_t	name_offset;	// into the string table
+		uint32_t	control_begin;
+		uint32_t	control_size;
+		double		origin[3];
+		double		dimension[3];
+		double		rotation[3];
+	};
+
+	struct ControlRecord {
+		uint32_t	type;
+		uint32_t	reserved;
+		double		limit[2];
+	};
+
+// Data
+protected:
+	// description
+	std::vector<NodeRecord>		record_list;
+	std::vector<ControlRecord>	control_record_list;
+	std::vector<char>			string_list;
+
+	// instance, owned by the arena
+	// the arena also owns the controls made by control(), everything is released by clear()
+	ModelArena arena;
+	std::vector<ModelObject*> node_list;
+	std::string error;
+
+// Operation
+public:
+	ModelSceneFile();
+
+	// file
+	// binary when the file starts with the magic, text otherwise
+	bool load(const char* path);
+	bool saveBinary(const char* path);
+	bool saveText(const char* path);
+	void clear();
+	const char* getError();
+	ModelArena* getArena();
+
+	// node
+	int32_t size();
+	ModelObject* getRoot();
+	ModelObject* getNode(int32_t index);
+	ModelObject* find(const char* name);
+
+	// control
+	// controls of the tree under root, in ModelObject::control order;
+	// nodes not from the file (added in code) use their own controlSelf
+	// every control is allocated from the arena of this file
+	void control(ModelObject* root, std::vector<ModelControl*>* controls);
+
+protected:
+	bool parseText(const char* data, size_t size);
+	bool parseBinary(const char* data, size_t size);
+	bool validate();
+	bool instantiate();
+	bool fail(const char* message);
+};
+
+
+#endif
@@ -21,6 +21,7 @@ Fl_Menu_Item ModelerUIWindows::menu_m_pmbMenuBar[] = {
  {0},
  {"&Animation", 0,  0, 0, 64, 0, 0, 14, 0},
  {"&Set Animation Length", 0,  0, 0, 0, 0, 0, 14, 0},
+ {"Si&mplify Curves...", 0,  0, 0, 0, 0, 0, 14, 0},
  {0},
  {0}
 };
@@ -37,6 +38,7 @@ Fl_Menu_Item* ModelerUIWindows::m_pmiMediumQuality = ModelerUIWindows::menu_m_pm
 Fl_Menu_Item* ModelerUIWindows::m_pmiLowQuality = ModelerUIWindows::menu_m_pmbMenuBar + 13;
 Fl_Menu_Item* ModelerUIWindows::m_pmiPoorQuality = ModelerUIWindows::menu_m_pmbMenuBar + 14;
 Fl_Menu_Item* ModelerUIWindows::m_pmiSetAniLen = ModelerUIWindows::menu_m_pmbMenuBar + 17;
+Fl_Menu_Item* ModelerUIWindows::m_pmiSimplifyCurves = ModelerUIWindows::menu_m_pmbMenuBar + 18;
 
 Fl_Menu_Item ModelerUIWindows::menu_m_pchoCurveType[] = {
  {"Linear", 0,  0, 0, 0, 0, 0, 12, 0},
@@ -0,0 +1,246 @@
+//
+// aviwriter.cpp
+//
+// Motion-JPEG AVI output, RIFF AVI 1.0 with an idx1 index
+//
+
+#include "aviwriter.h"
+
+#include <string.h>
+#ifdef _DEBUG
+#include <assert.h>
+#endif
+
+// 4MB stdio buffer, frames go to disk in large sequential writes
+static const size_t kBufferSize = 4 << 20;
+
+// byte offsets of the header fields close() fills in
+static const unsigned int kRiffSizeOffset		= 4;
+static const unsigned int kTotalFramesOffset	= 48;
+static const unsigned int kAvihBufferOffset		= 60;
+static const unsigned int kStrhLengthOffset		= 140;
+static const unsigned int kStrhBufferOffset		= 144;
+static const unsigned int kMoviSizeOffset		= 216;
+static const unsigned int kMoviOffset			= 220;
+static const unsigned int kHeaderSize			= 224;
+
+// AVIF_HASINDEX, AVIIF_KEYFRAME
+static const unsigned int kAviHasIndex			= 0x10;
+static const unsigned int kAviKeyFrame			= 0x10;
+
+AviWriter::AviWriter() :
+m_pfFile(NULL),
+m_uiPosition(0),
+m_uiMoviPosition(0),
+m_uiMaxFrameSize(0),
+m_bFailed(false)
+{
+}
+
+AviWriter::~AviWriter()
+{
+	close();
+}
+
+bool AviWriter::open(const char* szFileName, int iWidth, int iHeight, int iFps, int iFrameHint)
+{
+	close();
+	if (iWidth <= 0 || iHeight <= 0 || iFps <= 0)
+		return false;
+
+	if ((m_pfFile = fopen(szFileName, "wb")) == NULL)
+		return false;
+
+	m_vBuffer.resize(kBufferSize);
+	setvbuf(m_pfFile, &m_vBuffer[0], _IOFBF, m_vBuffer.size());
+
+	m_vIndex.clear();
+	if (iFrameHint > 0)
+		m_vIndex.reserve(iFrameHint);
+	m_uiPosition = 0;
+	m_uiMaxFrameSize = 0;
+	m_bFailed = false;
+
+	writeFourCC("RIFF");
+	writeDWord(0);							// file size, filled in by close()
+	writeFourCC("AVI ");
+
+	writeFourCC("LIST");
+	writeDWord(192);
+	writeFourCC("hdrl");
+
+	writeFourCC("avih");
+	writeDWord(56);
+	writeDWord(1000000 / iFps);				// microseconds per frame
+	writeDWord(0);							// max bytes per second
+	writeDWord(0);							// padding granularity
+	writeDWord(kAviHasIndex);
+	writeDWord(0);							// total frames
+	writeDWord(0);							// initial frames
+	writeDWord(1);							// streams
+	writeDWord(0);							// suggested buffer size
+	writeDWord(iWidth);
+	writeDWord(iHeight);
+	for (int i = 0; i < 4; ++i)
+		writeDWord(0);
+
+	writeFourCC("LIST");
+	writeDWord(116);
+	writeFourCC("strl");
+
+	writeFourCC("strh");
+	writeDWord(56);
+	writeFourCC("vids");
+	writeFourCC("MJPG");
+	writeDWord(0);							// flags
+	writeWord(0);							// priority
+	writeWord(0);							// language
+	writeDWord(0);							// initial frames
+	writeDWord(1);							// scale
+	writeDWord(iFps);						// rate, frames per second = rate / scale
+	writeDWord(0);							// start
+	writeDWord(0);							// length in frames
+	writeDWord(0);							// suggested buffer size
+	writeDWord(0xFFFFFFFF);					// quality, driver default
+	writeDWord(0);							// sample size, varies per frame
+	writeWord(0);
+	writeWord(0);
+	writeWord((unsigned short)iWidth);
+	writeWord((unsigned short)iHeight);
+
+	writeFourCC("strf");
+	writeDWord(40);
+	writeDWord(40);							// BITMAPINFOHEADER size
+	writeDWord(iWidth);
+	writeDWord(iHeight);
+	writeWord(1);							// planes
+	writeWord(24);							// bit count
+	writeFourCC("MJPG");
+	writeDWord(iWidth * iHeight * 3);
+	writeDWord(0);
+	writeDWord(0);
+	writeDWord(0);
+	writeDWord(0);
+
+	writeFourCC("LIST");
+	writeDWord(0);							// movi size, filled in by close()
+	writeFourCC("movi");
+
+#ifdef _DEBUG
+	assert(m_uiPosition == kHeaderSize);
+#endif
+	m_uiMoviPosition = kMoviOffset;
+
+	if (m_bFailed) {
+		fclose(m_pfFile);
+		m_pfFile = NULL;
+		return false;
+	}
+	return true;
+}
+
+bool AviWriter::writeFrame(const unsigned char* pbyData, int iSize)
+{
+	if (m_pfFile == NULL || m_bFailed || iSize <= 0)
+		return false;
+
+	// the chunk, its index entry and the idx1 header must still fit the 32-bit RIFF sizes
+	const unsigned int uiPadded = (unsigned int)iSize + (iSize & 1);
+	const unsigned long long ullEnd = (unsigned long long)m_uiPosition + 8 + uiPadded +
+		16 * ((unsigned long long)m_vIndex.size() + 1) + 8;
+	if (ullEnd > 0xFFFFFFFFull)
+		return false;
+
+	IndexEntry entry;
+	entry.uiOffset = m_uiPosition - m_uiMoviPosition;
+	entry.uiSize = (unsigned int)iSize;
+
+	writeFourCC("00dc");
+	writeDWord((unsigned int)iSize);
+	if (fwrite(pbyData, 1, iSize, m_pfFile) != (size_t)iSize)
+		m_bFailed = true;
+	m_uiPosition += iSize;
+	if (iSize & 1) {
+		if (fputc(0, m_pfFile) == EOF)
+			m_bFailed = true;
+		++m_uiPosition;
+	}
+
+	if (m_bFailed)
+		return false;
+
+	m_vIndex.push_back(entry);
+	if (entry.uiSize > m_uiMaxFrameSize)
+		m_uiMaxFrameSize = entry.uiSize;
+	return true;
+}
+
+bool AviWriter::close()
+{
+	if (m_pfFile == NULL)
+		return false;
+
+	const unsigned int uiMoviEnd = m_uiPosition;
+
+	writeFourCC("idx1");
+	writeDWord((unsigned int)m_vIndex.size() * 16);
+	for (size_t i = 0; i < m_vIndex.size(); ++i) {
+		writeFourCC("00dc");
+		writeDWord(kAviKeyFrame);
+		writeDWord(m_vIndex[i].uiOffset);
+		writeDWord(m_vIndex[i].uiSize);
+	}
+
+	const unsigned int uiFrames = (unsigned int)m_vIndex.size();
+	patchDWord(kRiffSizeOffset, m_uiPosition - 8);
+	patchDWord(kMoviSizeOffset, uiMoviEnd - kMoviOffset);
+	patchDWord(kTotalFramesOffset, uiFrames);
+	patchDWord(kStrhLengthOffset, uiFrames);
+	patchDWord(kAvihBufferOffset, m_uiMaxFrameSize + 8);
+	patchDWord(kStrhBufferOffset, m_uiMaxFrameSize + 8);
+
+	if (fclose(m_pfFile) != 0)
+		m_bFailed = true;
+	m_pfFile = NULL;
+	m_vBuffer.clear();
+
+	return !m_bFailed;
+}
+
+void AviWriter::writeFourCC(const char* szFourCC)
+{
+	if (fwrite(szFourCC, 1, 4, m_pfFile) != 4)
+		m_bFailed = true;
+	m_uiPosition += 4;
+}
+
+void AviWriter::writeWord(unsigned short usValue)
+{
+	unsigned char aby[2] = { (unsigned char)usValue, (unsigned char)(usValue >> 8) };
+	if (fwrite(aby, 1, 2, m_pfFile) != 2)
+		m_bFailed = true;
+	m_uiPosition += 2;
+}
+
+void AviWriter::writeDWord(unsigned int uiValue)
+{
+	unsigned char aby[4] = {
+		(unsigned char)uiValue, (unsigned char)(uiValue >> 8),
+		(unsigned char)(uiValue >> 16), (unsigned char)(uiValue >> 24) };
+	if (fwrite(aby, 1, 4, m_pfFile) != 4)
+		m_bFailed = true;
+	m_uiPosition += 4;
+}
+
+void AviWriter::patchDWord(unsigned int uiPosition, unsigned int uiValue)
+{
+	// the header fields all sit in the first few hundred bytes
+	const unsigned int uiEnd = m_uiPosition;
+	if (fseek(m_pfFile, (long)uiPosition, SEEK_SET) != 0) {
+		m_bFailed = true;
+		return;
+	}
+	writeDWord(uiValue);
+	fseek(m_pfFile, 0, SEEK_END);
+	m_uiPosition = uiEnd;
+}
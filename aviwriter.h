@@ -0,0 +1,59 @@
+//
+// aviwriter.h
+//
+// Streams Motion-JPEG frames into a single AVI file.  Frames are appended
+// through a large stdio buffer, the index is kept in memory and written,
+// together with the final frame counts, when the file is closed.
+//
+
+#ifndef AVIWRITER_H
+#define AVIWRITER_H
+
+#include <stdio.h>
+#include <vector>
+
+class AviWriter
+{
+public:
+	AviWriter();
+	~AviWriter();
+
+	// Create the file and write the headers; iFrameHint sizes the index
+	bool open(const char* szFileName, int iWidth, int iHeight, int iFps, int iFrameHint = 0);
+
+	// Append one JPEG-compressed frame
+	bool writeFrame(const unsigned char* pbyData, int iSize);
+
+	// Write the index, fill in the header counts and close the file
+	bool close();
+
+	bool isOpen() const { return m_pfFile != NULL; }
+	int frameCount() const { return (int)m_vIndex.size(); }
+
+private:
+	AviWriter(const AviWriter&);
+	AviWriter& operator=(const AviWriter&);
+
+	struct IndexEntry
+	{
+		unsigned int uiOffset;
+		unsigned int uiSize;
+	};
+
+	void writeFourCC(const char* szFourCC);
+	void writeWord(unsigned short usValue);
+	void writeDWord(unsigned int uiValue);
+	void patchDWord(unsigned int uiPosition, unsigned int uiValue);
+
+	FILE* m_pfFile;
+	std::vector<char> m_vBuffer;
+	std::vector<IndexEntry> m_vIndex;
+
+	// bytes written so far; RIFF sizes are 32-bit, so the file stays under 4GB
+	unsigned int m_uiPosition;
+	unsigned int m_uiMoviPosition;
+	unsigned int m_uiMaxFrameSize;
+	bool m_bFailed;
+};
+
+#endif
@@ -5,9 +5,29 @@
 //
 
 #include "bitmap.h"
- 
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <stdio.h>
 #include <string.h>
+#include <vector>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define BMP_SSSE3
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
 
 #define BMP_BI_RGB        0L
 
@@ -44,104 +64,81 @@ typedef struct {
 
 #pragma pack(pop)
 
-BMP_BITMAPFILEHEADER bmfh; 
-BMP_BITMAPINFOHEADER bmih; 
+static const unsigned char* bmpMapFile(const char* szFileName, size_t& iSize, void*& pvHandle);
+static void bmpUnmapFile(const unsigned char* pbyData, size_t iSize, void* pvHandle);
+static void bmpSwapRedBlue(unsigned char* pbyOut, const unsigned char* pbyIn, int iPixels);
+
 
 unsigned char* readBMP(const char *szFileName, int& iWidth, int& iHeight)
 { 
-	FILE* pfBMPFile;
-	BMP_DWORD dwPos;
+	size_t iFileSize = 0;
+	void* pvHandle = NULL;
+	const unsigned char* pbyFile = bmpMapFile(szFileName, iFileSize, pvHandle);
+	if (pbyFile == NULL)
+		return NULL;
+
 	unsigned char *pbyData = NULL; 
- 
-	do {
-		if ((pfBMPFile = fopen(szFileName, "rb")) == NULL)
-			break; 
 
-		fread(&bmfh, sizeof(BMP_BITMAPFILEHEADER), 1, pfBMPFile);
+	do {
+		// headers are copied out of the mapping, it need not be aligned
+		BMP_BITMAPFILEHEADER bmfh;
+		BMP_BITMAPINFOHEADER bmih;
+		if (iFileSize < sizeof(bmfh) + sizeof(bmih))
+			break;
+		memcpy(&bmfh, pbyFile, sizeof(bmfh));
+		memcpy(&bmih, pbyFile + sizeof(bmfh), sizeof(bmih));
 
-		dwPos = bmfh.bfOffBits; 
- 
-		fread(&bmih, sizeof(BMP_BITMAPINFOHEADER), 1, pfBMPFile); 
- 
 		// error checking
-		if (bmfh.bfType!= 0x4d42) {	// "BM" actually
+		if (bmfh.bfType != 0x4d42)	// "BM" actually
 			break;
-		}
-		if (bmih.biBitCount != 24)  
+		if (bmih.biBitCount != 24 || bmih.biCompression != BMP_BI_RGB)
+			break;
+		if (bmih.biWidth <= 0 || bmih.biHeight == 0)
 			break;
-		/*
- 		if (bmih.biCompression != BMP_BI_RGB) {
-			return NULL;
-		}
-		*/
-		fseek(pfBMPFile, dwPos, SEEK_SET); 
- 
-		iWidth = bmih.biWidth; 
-		iHeight = bmih.biHeight; 
- 
-		int iPadWidth = iWidth * 3; 
-		int iPad = 0; 
-		if (iPadWidth % 4 != 0) { 
-			iPad = 4 - (iPadWidth % 4); 
-			iPadWidth += iPad; 
-		} 
-		int iBytes = iHeight * iPadWidth; 
- 
-		pbyData = new unsigned char[iBytes]; 
 
-		int iBytesRead = fread(pbyData, iBytes, 1, pfBMPFile); 
-		
-		if (!iBytesRead) {
-			delete [] pbyData;
-			pbyData = NULL;
+		// a negative height marks top-down rows, callers always get bottom-up
+		const bool bTopDown = (bmih.biHeight < 0);
+		const int iW = bmih.biWidth;
+		const int iH = bTopDown ? -bmih.biHeight : bmih.biHeight;
+
+		const size_t iRowBytes = (size_t)iW * 3;
+		const size_t iPadWidth = (iRowBytes + 3) & ~(size_t)3;
+		if (bmfh.bfOffBits > iFileSize || (iFileSize - bmfh.bfOffBits) / iPadWidth < (size_t)iH)
 			break;
-		}
 
-		// shuffle bitmap data such that it is (R,G,B) tuples in row-major order
-		// also get away with the padding
-		int i, j;
-		j = 0;
-		unsigned char byTemp;
-		unsigned char* pbyIn;
-		unsigned char* pbyOut;
-
-		pbyIn = pbyData;
-		pbyOut = pbyData;
-
-		for (j = 0; j < iHeight; ++j) {
-			for (i = 0; i < iWidth; ++i) {
-				pbyOut[1] = pbyIn[1];
-				byTemp = pbyIn[2];
-				pbyOut[2] = pbyIn[0];
-				pbyOut[0] = byTemp;
-
-				pbyIn += 3;
-				pbyOut += 3;
-			}
-			pbyIn += iPad;
+		// (R,G,B) tuples in row-major order, without the padding
+		pbyData = new unsigned char[iRowBytes * iH];
+		const unsigned char* pbyPixels = pbyFile + bmfh.bfOffBits;
+		for (int j = 0; j < iH; ++j) {
+			const int iSrcRow = bTopDown ? (iH - 1 - j) : j;
+			bmpSwapRedBlue(pbyData + j * iRowBytes, pbyPixels + iSrcRow * iPadWidth, iW);
 		}
-	} while (false);
 
-	if (pfBMPFile)
-		fclose(pfBMPFile);
+		iWidth = iW;
+		iHeight = iH;
+	} while (false);
 
+	bmpUnmapFile(pbyFile, iFileSize, pvHandle);
 	return pbyData; 
 } 
  
 bool writeBMP(const char* szFileName, int iWidth, int iHeight, const unsigned char* pbyData) 
 { 
-	int iBytes, iPad;
-	iBytes = iWidth * 3;
-	iPad = (iBytes % 4) ? 4 - (iBytes % 4) : 0;
-	iBytes += iPad;
-	iBytes *= iHeight;
+	if (iWidth <= 0 || iHeight <= 0)
+		return false;
+
+	const size_t iRowBytes = (size_t)iWidth * 3;
+	const size_t iPadWidth = (iRowBytes + 3) & ~(size_t)3;
+	const size_t iBytes = iPadWidth * iHeight;
 
+	BMP_BITMAPFILEHEADER bmfh;
 	bmfh.bfType = 0x4d42; // "BM"
-	bmfh.bfSize = sizeof(BMP_BITMAPFILEHEADER) + sizeof(BMP_BITMAPINFOHEADER) + iBytes;
+	bmfh.bfSize = (BMP_DWORD)(sizeof(BMP_BITMAPFILEHEADER) + sizeof(BMP_BITMAPINFOHEADER) + iBytes);
 	bmfh.bfReserved1 = 0;
 	bmfh.bfReserved2 = 0;
 	bmfh.bfOffBits = sizeof(BMP_BITMAPFILEHEADER) + sizeof(BMP_BITMAPINFOHEADER);
 
+	BMP_BITMAPINFOHEADER bmih;
 	bmih.biSize = sizeof(BMP_BITMAPINFOHEADER);
 	bmih.biWidth = iWidth;
 	bmih.biHeight = iHeight;
@@ -154,28 +151,134 @@ bool writeBMP(const char* szFileName, int iWidth, int iHeight, const unsigned ch
 	bmih.biClrUsed = 0;
 	bmih.biClrImportant = 0;
 
-	FILE* pfBMPFile = fopen(szFileName, "wb");
+	// the whole file is laid out in one buffer and written with a single call;
+	// each thread keeps its buffer, so movie frames don't reallocate
+	static thread_local std::vector<unsigned char> vFile;
+	vFile.resize(bmfh.bfSize);
 
-	if (pfBMPFile) {
-		fwrite(&bmfh, sizeof(BMP_BITMAPFILEHEADER), 1, pfBMPFile);
-		fwrite(&bmih, sizeof(BMP_BITMAPINFOHEADER), 1, pfBMPFile); 
-
-		iBytes /= iHeight;
-		unsigned char* pbyScanLine = new unsigned char[iBytes];
-		for (int j = 0; j < iHeight; ++j) {
-			memcpy(pbyScanLine, pbyData + j * 3 * iWidth, iBytes);
-			for (int i = 0; i < iWidth; ++i) {
-				unsigned char byTemp = pbyScanLine[i * 3];
-				pbyScanLine[i * 3] = pbyScanLine[i * 3 + 2];
-				pbyScanLine[i * 3 + 2] = byTemp;
-			}
-			fwrite(pbyScanLine, iBytes, 1, pfBMPFile);
-		}
+	unsigned char* pbyFile = &vFile[0];
+	memcpy(pbyFile, &bmfh, sizeof(bmfh));
+	memcpy(pbyFile + sizeof(bmfh), &bmih, sizeof(bmih));
 
-		delete [] pbyScanLine;
-		fclose(pfBMPFile);
-		return true;
+	unsigned char* pbyPixels = pbyFile + bmfh.bfOffBits;
+	for (int j = 0; j < iHeight; ++j) {
+		unsigned char* pbyRow = pbyPixels + j * iPadWidth;
+		bmpSwapRedBlue(pbyRow, pbyData + j * iRowBytes, iWidth);
+		memset(pbyRow + iRowBytes, 0, iPadWidth - iRowBytes);
 	}
 
-	return false;
+	FILE* pfBMPFile = fopen(szFileName, "wb");
+	if (pfBMPFile == NULL)
+		return false;
+
+	const bool bWritten = (fwrite(pbyFile, 1, vFile.size(), pfBMPFile) == vFile.size());
+	return (fclose(pfBMPFile) == 0) && bWritten;
 } 
+
+
+static const unsigned char* bmpMapFile(const char* szFileName, size_t& iSize, void*& pvHandle)
+{
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(szFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) return NULL;
+
+	LARGE_INTEGER liSize;
+	if (!GetFileSizeEx(hFile, &liSize) || liSize.QuadPart == 0) {
+		CloseHandle(hFile);
+		return NULL;
+	}
+
+	HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(hFile);
+	if (hMapping == NULL) return NULL;
+
+	const unsigned char* pbyData = (const unsigned char*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (pbyData == NULL) {
+		CloseHandle(hMapping);
+		return NULL;
+	}
+
+	iSize = (size_t)liSize.QuadPart;
+	pvHandle = hMapping;
+	return pbyData;
+#else
+	const int iFile = open(szFileName, O_RDONLY);
+	if (iFile < 0) return NULL;
+
+	struct stat fileStat;
+	if (fstat(iFile, &fileStat) != 0 || fileStat.st_size == 0) {
+		close(iFile);
+		return NULL;
+	}
+
+	void* pvData = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, iFile, 0);
+	close(iFile);
+	if (pvData == MAP_FAILED) return NULL;
+
+	iSize = fileStat.st_size;
+	pvHandle = NULL;
+	return (const unsigned char*)pvData;
+#endif
+}
+
+static void bmpUnmapFile(const unsigned char* pbyData, size_t iSize, void* pvHandle)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(pbyData);
+	CloseHandle((HANDLE)pvHandle);
+#else
+	munmap((void*)pbyData, iSize);
+#endif
+}
+
+#ifdef BMP_SSSE3
+static bool bmpHasSSSE3()
+{
+	int aiInfo[4] = { 0, 0, 0, 0 };
+#ifdef _MSC_VER
+	__cpuid(aiInfo, 1);
+#else
+	unsigned int a, b, c, d;
+	if (__get_cpuid(1, &a, &b, &c, &d))
+		aiInfo[2] = (int)c;
+#endif
+	return (aiInfo[2] & (1 << 9)) != 0;
+}
+
+#if defined(__GNUC__) && !defined(__SSSE3__)
+__attribute__((target("ssse3")))
+#endif
+static int bmpSwapRedBlueSSSE3(unsigned char* pbyOut, const unsigned char* pbyIn, int iBytes)
+{
+	// five whole pixels per 16-byte shuffle; the 16th byte is
+	// stored unchanged and rewritten by the next step
+	const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+
+	int i = 0;
+	for (; i + 16 <= iBytes; i += 15) {
+		const __m128i pixels = _mm_loadu_si128((const __m128i*)(pbyIn + i));
+		_mm_storeu_si128((__m128i*)(pbyOut + i), _mm_shuffle_epi8(pixels, mask));
+	}
+	return i;
+}
+#endif
+
+// BGR <-> RGB, the same swap in both directions
+static void bmpSwapRedBlue(unsigned char* pbyOut, const unsigned char* pbyIn, int iPixels)
+{
+	const int iBytes = iPixels * 3;
+	int i = 0;
+
+#ifdef BMP_SSSE3
+	static const bool bSSSE3 = bmpHasSSSE3();
+	if (bSSSE3)
+		i = bmpSwapRedBlueSSSE3(pbyOut, pbyIn, iBytes);
+#endif
+
+	for (; i < iBytes; i += 3) {
+		const unsigned char byTemp = pbyIn[i];
+		pbyOut[i + 1] = pbyIn[i + 1];
+		pbyOut[i] = pbyIn[i + 2];
+		pbyOut[i + 2] = byTemp;
+	}
+}
@@ -0,0 +1,258 @@
+//
+// bitmapbench.cpp
+//
+// time readBMP / writeBMP against the original fread/fwrite implementation.
+// Not part of the Animator project build (it has its own main), compile it
+// together with bitmap.cpp, e.g.
+//   cl /O2 /EHsc bitmapbench.cpp bitmap.cpp
+// and run
+//   bitmapbench [width height [count]]
+// which works on a width x height frame, 1920x1080 by default, count times
+// each, through files in the current directory; prints the timings and
+// returns non-zero when a result differs
+//
+
+#include "bitmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#define BMP_BI_RGB        0L
+
+typedef unsigned short BMP_WORD; 
+typedef unsigned int BMP_DWORD; 
+typedef int BMP_LONG; 
+ 
+#pragma pack(push)
+// word-aligned structure, so that the following two
+// structures will have the sizes we expect.
+#pragma pack(2) 
+
+typedef struct { 
+	BMP_WORD        bfType; 
+	BMP_DWORD       bfSize; 
+	BMP_WORD        bfReserved1; 
+	BMP_WORD        bfReserved2; 
+	BMP_DWORD       bfOffBits; 
+} BMP_BITMAPFILEHEADER; 
+ 
+typedef struct { 
+	BMP_DWORD       biSize; 
+	BMP_LONG        biWidth; 
+	BMP_LONG        biHeight; 
+	BMP_WORD        biPlanes; 
+	BMP_WORD        biBitCount; 
+	BMP_DWORD       biCompression; 
+	BMP_DWORD       biSizeImage; 
+	BMP_LONG        biXPelsPerMeter; 
+	BMP_LONG        biYPelsPerMeter; 
+	BMP_DWORD       biClrUsed; 
+	BMP_DWORD       biClrImportant; 
+} BMP_BITMAPINFOHEADER; 
+
+#pragma pack(pop)
+
+// the original implementation, kept as the baseline
+static unsigned char* readBMPReference(const char *szFileName, int& iWidth, int& iHeight)
+{ 
+	BMP_BITMAPFILEHEADER bmfh; 
+	BMP_BITMAPINFOHEADER bmih; 
+	FILE* pfBMPFile;
+	BMP_DWORD dwPos;
+	unsigned char *pbyData = NULL; 
+ 
+	do {
+		if ((pfBMPFile = fopen(szFileName, "rb")) == NULL)
+			break; 
+
+		fread(&bmfh, sizeof(BMP_BITMAPFILEHEADER), 1, pfBMPFile);
+
+		dwPos = bmfh.bfOffBits; 
+ 
+		fread(&bmih, sizeof(BMP_BITMAPINFOHEADER), 1, pfBMPFile); 
+ 
+		// error checking
+		if (bmfh.bfType!= 0x4d42) {	// "BM" actually
+			break;
+		}
+		if (bmih.biBitCount != 24)  
+			break;
+		fseek(pfBMPFile, dwPos, SEEK_SET); 
+ 
+		iWidth = bmih.biWidth; 
+		iHeight = bmih.biHeight; 
+ 
+		int iPadWidth = iWidth * 3; 
+		int iPad = 0; 
+		if (iPadWidth % 4 != 0) { 
+			iPad = 4 - (iPadWidth % 4); 
+			iPadWidth += iPad; 
+		} 
+		int iBytes = iHeight * iPadWidth; 
+ 
+		pbyData = new unsigned char[iBytes]; 
+
+		int iBytesRead = fread(pbyData, iBytes, 1, pfBMPFile); 
+		
+		if (!iBytesRead) {
+			delete [] pbyData;
+			pbyData = NULL;
+			break;
+		}
+
+		// shuffle bitmap data such that it is (R,G,B) tuples in row-major order
+		// also get away with the padding
+		int i, j;
+		j = 0;
+		unsigned char byTemp;
+		unsigned char* pbyIn;
+		unsigned char* pbyOut;
+
+		pbyIn = pbyData;
+		pbyOut = pbyData;
+
+		for (j = 0; j < iHeight; ++j) {
+			for (i = 0; i < iWidth; ++i) {
+				pbyOut[1] = pbyIn[1];
+				byTemp = pbyIn[2];
+				pbyOut[2] = pbyIn[0];
+				pbyOut[0] = byTemp;
+
+				pbyIn += 3;
+				pbyOut += 3;
+			}
+			pbyIn += iPad;
+		}
+	} while (false);
+
+	if (pfBMPFile)
+		fclose(pfBMPFile);
+
+	return pbyData; 
+} 
+ 
+static bool writeBMPReference(const char* szFileName, int iWidth, int iHeight, const unsigned char* pbyData) 
+{ 
+	BMP_BITMAPFILEHEADER bmfh; 
+	BMP_BITMAPINFOHEADER bmih; 
+	int iBytes, iPad;
+	iBytes = iWidth * 3;
+	iPad = (iBytes % 4) ? 4 - (iBytes % 4) : 0;
+	iBytes += iPad;
+	iBytes *= iHeight;
+
+	bmfh.bfType = 0x4d42; // "BM"
+	bmfh.bfSize = sizeof(BMP_BITMAPFILEHEADER) + sizeof(BMP_BITMAPINFOHEADER) + iBytes;
+	bmfh.bfReserved1 = 0;
+	bmfh.bfReserved2 = 0;
+	bmfh.bfOffBits = sizeof(BMP_BITMAPFILEHEADER) + sizeof(BMP_BITMAPINFOHEADER);
+
+	bmih.biSize = sizeof(BMP_BITMAPINFOHEADER);
+	bmih.biWidth = iWidth;
+	bmih.biHeight = iHeight;
+	bmih.biPlanes = 1;
+	bmih.biBitCount = 24;
+	bmih.biCompression = BMP_BI_RGB;
+	bmih.biSizeImage = 0;
+	bmih.biXPelsPerMeter = (int)(100 / 2.54 * 72);
+	bmih.biYPelsPerMeter = (int)(100 / 2.54 * 72);
+	bmih.biClrUsed = 0;
+	bmih.biClrImportant = 0;
+
+	FILE* pfBMPFile = fopen(szFileName, "wb");
+
+	if (pfBMPFile) {
+		fwrite(&bmfh, sizeof(BMP_BITMAPFILEHEADER), 1, pfBMPFile);
+		fwrite(&bmih, sizeof(BMP_BITMAPINFOHEADER), 1, pfBMPFile); 
+
+		iBytes /= iHeight;
+		unsigned char* pbyScanLine = new unsigned char[iBytes];
+		for (int j = 0; j < iHeight; ++j) {
+			memcpy(pbyScanLine, pbyData + j * 3 * iWidth, iBytes);
+			for (int i = 0; i < iWidth; ++i) {
+				unsigned char byTemp = pbyScanLine[i * 3];
+				pbyScanLine[i * 3] = pbyScanLine[i * 3 + 2];
+				pbyScanLine[i * 3 + 2] = byTemp;
+			}
+			fwrite(pbyScanLine, iBytes, 1, pfBMPFile);
+		}
+
+		delete [] pbyScanLine;
+		fclose(pfBMPFile);
+		return true;
+	}
+
+	return false;
+}
+
+static bool benchBMP(int iWidth, int iHeight, int iCount)
+{
+	if (iWidth <= 0 || iHeight <= 0 || iCount <= 0)
+		return false;
+
+	typedef std::chrono::steady_clock Clock;
+	const char* szNew = "bench_bmp_new.bmp";
+	const char* szReference = "bench_bmp_reference.bmp";
+
+	// a gradient, so a swapped channel shows up in the comparison; the
+	// reference writer reads up to 3 bytes past each row, hence the slack
+	const size_t iFrameBytes = (size_t)iWidth * iHeight * 3;
+	std::vector<unsigned char> vFrame(iFrameBytes + 4, 0);
+	for (size_t i = 0; i < iFrameBytes; ++i)
+		vFrame[i] = (unsigned char)(i * 7 + i / 3);
+
+	double adTime[4] = { 0, 0, 0, 0 };	// write reference, write new, read reference, read new
+	bool bSame = true;
+
+	for (int k = 0; k < iCount && bSame; ++k) {
+		Clock::time_point t0 = Clock::now();
+		const bool bWrittenReference = writeBMPReference(szReference, iWidth, iHeight, &vFrame[0]);
+		Clock::time_point t1 = Clock::now();
+		const bool bWrittenNew = writeBMP(szNew, iWidth, iHeight, &vFrame[0]);
+		Clock::time_point t2 = Clock::now();
+
+		int iW = 0, iH = 0;
+		unsigned char* pbyReference = readBMPReference(szNew, iW, iH);
+		Clock::time_point t3 = Clock::now();
+		unsigned char* pbyNew = readBMP(szReference, iW, iH);
+		Clock::time_point t4 = Clock::now();
+
+		adTime[0] += std::chrono::duration<double, std::milli>(t1 - t0).count();
+		adTime[1] += std::chrono::duration<double, std::milli>(t2 - t1).count();
+		adTime[2] += std::chrono::duration<double, std::milli>(t3 - t2).count();
+		adTime[3] += std::chrono::duration<double, std::milli>(t4 - t3).count();
+
+		// each reader gets the file of the other writer; the reference reader
+		// only unpads correctly when the rows need no padding
+		bSame = bWrittenReference && bWrittenNew && pbyNew != NULL && pbyReference != NULL &&
+			memcmp(pbyNew, &vFrame[0], iFrameBytes) == 0 &&
+			((iWidth * 3) % 4 != 0 || memcmp(pbyReference, &vFrame[0], iFrameBytes) == 0);
+
+		delete [] pbyReference;
+		delete [] pbyNew;
+	}
+
+	remove(szNew);
+	remove(szReference);
+
+	if (!bSame) {
+		fprintf(stderr, "ERROR: readBMP/writeBMP differ from the reference on a %dx%d frame\n", iWidth, iHeight);
+		return false;
+	}
+
+	printf("%dx%d, %d runs, average ms\n", iWidth, iHeight, iCount);
+	printf("  write  reference %8.3f  new %8.3f\n", adTime[0] / iCount, adTime[1] / iCount);
+	printf("  read   reference %8.3f  new %8.3f\n", adTime[2] / iCount, adTime[3] / iCount);
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	const int iWidth  = (argc > 2) ? atoi(argv[1]) : 1920;
+	const int iHeight = (argc > 2) ? atoi(argv[2]) : 1080;
+	const int iCount  = (argc > 3) ? atoi(argv[3]) : 20;
+	return benchBMP(iWidth, iHeight, iCount) ? 0 : 1;
+}
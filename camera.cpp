@@ -260,6 +260,43 @@ void Camera::applyViewingTransform() {
 }
 
 
+// gluLookAt, row-major
+Mat4d Camera::getViewMatrix() {
+	if( mDirtyTransform )
+		calculateViewingTransformParameters();
+
+	double f[3], s[3], u[3];
+	for (int i = 0; i < 3; i++)
+		f[i] = mLookAt[i] - mPosition[i];
+
+	double fLength = sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+	if (fLength > 0) {
+		for (int i = 0; i < 3; i++) f[i] /= fLength;
+	}
+
+	// s = f x up, u = s x f
+	s[0] = f[1] * mUpVector[2] - f[2] * mUpVector[1];
+	s[1] = f[2] * mUpVector[0] - f[0] * mUpVector[2];
+	s[2] = f[0] * mUpVector[1] - f[1] * mUpVector[0];
+
+	double sLength = sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+	if (sLength > 0) {
+		for (int i = 0; i < 3; i++) s[i] /= sLength;
+	}
+
+	u[0] = s[1] * f[2] - s[2] * f[1];
+	u[1] = s[2] * f[0] - s[0] * f[2];
+	u[2] = s[0] * f[1] - s[1] * f[0];
+
+	const double e[3] = { mPosition[0], mPosition[1], mPosition[2] };
+	return Mat4d(
+		 s[0],  s[1],  s[2], -(s[0] * e[0] + s[1] * e[1] + s[2] * e[2]),
+		 u[0],  u[1],  u[2], -(u[0] * e[0] + u[1] * e[1] + u[2] * e[2]),
+		-f[0], -f[1], -f[2],   f[0] * e[0] + f[1] * e[1] + f[2] * e[2],
+		 0,     0,     0,      1);
+}
+
+
 /** Update camera params based on keyframes **/
 void Camera::update(float t)
 {
@@ -94,6 +94,9 @@ public:
     //---[ Viewing Transform ]--------------------------------
     void applyViewingTransform();
 
+    // same transform as applyViewingTransform, for use without GL
+    Mat4d getViewMatrix();
+
 	//---[ Animation ]-------------------------------------
 	void createCurves(float t, float maxX);
 	void deleteCurves();
@@ -17,10 +17,60 @@
 
 float Curve::s_fCtrlPtXEpsilon = 0.0001f;
 
+// largest vertical distance from the chord pt_1 - pt_2, over the points in (iFirst, iLast)
+// a chord of zero width covers the y range between its ends
+static int farthest_from_chord(const std::vector<Point>& ptvPts, int iFirst, int iLast, float& fDistance)
+{
+	const Point& pt_1 = ptvPts[iFirst];
+	const Point& pt_2 = ptvPts[iLast];
+	const float fWidth = pt_2.x - pt_1.x;
+	const float fSlope = (fWidth != 0.0f) ? (pt_2.y - pt_1.y) / fWidth : 0.0f;
+	const float fLow = (pt_1.y < pt_2.y) ? pt_1.y : pt_2.y;
+	const float fHigh = (pt_1.y < pt_2.y) ? pt_2.y : pt_1.y;
+
+	int iFarthest = -1;
+	fDistance = 0.0f;
+
+	for (int i = iFirst + 1; i < iLast; ++i) {
+		const float y = ptvPts[i].y;
+		const float fDist = (fWidth != 0.0f) ?
+			fabs(pt_1.y + (ptvPts[i].x - pt_1.x) * fSlope - y) :
+			(y < fLow) ? fLow - y : (y > fHigh) ? y - fHigh : 0.0f;
+		if (fDist > fDistance) {
+			fDistance = fDist;
+			iFarthest = i;
+		}
+	}
+
+	return iFarthest;
+}
+
+// y of the evaluated curve at x, interpolated between its samples (sorted in x)
+// iEvalPt is where the sweep left off, so increasing x is a single pass
+static float evaluated_y(const std::vector<Point>& ptvEvaluated, int& iEvalPt, float x)
+{
+	while (iEvalPt + 2 < ptvEvaluated.size() && ptvEvaluated[iEvalPt + 1].x < x)
+		++iEvalPt;
+
+	float y = ptvEvaluated[iEvalPt].y;
+	if (iEvalPt + 1 < ptvEvaluated.size()) {
+		const Point& point_one = ptvEvaluated[iEvalPt];
+		const Point& point_two = ptvEvaluated[iEvalPt + 1];
+		if (point_one.x != point_two.x) {
+			float fT = (x - point_one.x) / (point_two.x - point_one.x);
+			if (fT < 0.0f) fT = 0.0f;
+			if (fT > 1.0f) fT = 1.0f;
+			y = point_one.y + (point_two.y - point_one.y) * fT;
+		}
+	}
+	return y;
+}
+
 Curve::Curve() :
 	m_pceEvaluator(NULL),
 	m_bWrap(false),
 	m_bDirty(true),
+	m_fBakedFps(0.0f),
 	m_fMaxX(1.0f)
 {
 	init();
@@ -30,6 +80,7 @@ Curve::Curve(const float fMaxX, const Point& point) :
 	m_pceEvaluator(NULL),
 	m_bWrap(false),
 	m_bDirty(true),
+	m_fBakedFps(0.0f),
 	m_fMaxX(fMaxX)
 {
 	addControlPoint(point);
@@ -39,6 +90,7 @@ Curve::Curve(const float fMaxX, const float fStartYValue) :
 	m_pceEvaluator(NULL),
 	m_bWrap(false),
 	m_bDirty(true),
+	m_fBakedFps(0.0f),
 	m_fMaxX(fMaxX)
 {
 	init(fStartYValue);
@@ -63,7 +115,12 @@ void Curve::maxX(const float fNewMaxX)
 	m_bDirty = true;
 }
 
-Curve::Curve(std::istream& isInputStream)
+Curve::Curve(std::istream& isInputStream) :
+	m_pceEvaluator(NULL),
+	m_bWrap(false),
+	m_bDirty(true),
+	m_fBakedFps(0.0f),
+	m_fMaxX(1.0f)
 {
 	fromStream(isInputStream);
 }
@@ -403,6 +460,135 @@ void Curve::drawControlPoints() const
 	glPointSize(fPointSize);
 }
 
+int Curve::simplify(const float fTolerance)
+{
+	const int iCtrlPtCount = m_ptvCtrlPts.size();
+	if (iCtrlPtCount <= 2)
+		return 0;
+
+	std::vector<bool> bvKeep(iCtrlPtCount, false);
+	bvKeep[0] = true;
+	bvKeep[iCtrlPtCount - 1] = true;
+
+	// Ramer-Douglas-Peucker on the control points, with an explicit stack
+	// so that long recordings do not recurse thousands deep
+	std::vector<std::pair<int, int> > ivpSpans;
+	ivpSpans.push_back(std::make_pair(0, iCtrlPtCount - 1));
+
+	while (!ivpSpans.empty()) {
+		const std::pair<int, int> span = ivpSpans.back();
+		ivpSpans.pop_back();
+
+		float fDistance;
+		const int iFarthest = farthest_from_chord(m_ptvCtrlPts, span.first, span.second, fDistance);
+
+		if (iFarthest >= 0 && fDistance > fTolerance) {
+			bvKeep[iFarthest] = true;
+			ivpSpans.push_back(std::make_pair(span.first, iFarthest));
+			ivpSpans.push_back(std::make_pair(iFarthest, span.second));
+		}
+	}
+
+	// the evaluator may be a spline rather than a polyline, which need not pass
+	// through its control points; so the original curve is evaluated once, and
+	// every reduced curve is checked against those samples through the same
+	// evaluator; a span still out of tolerance gets back the dropped point
+	// closest to its worst sample
+	// keys are only ever picked from the original ones, never refitted, and
+	// each pass re-evaluates the whole reduced curve
+	std::vector<Point> ptvOriginal;
+	std::vector<Point> ptvKept;
+	std::vector<Point> ptvEvaluated;
+	std::vector<int> ivKept;
+
+	if (m_pceEvaluator) {
+		m_pceEvaluator->evaluateCurve(m_ptvCtrlPts, ptvOriginal, m_fMaxX, m_bWrap);
+		std::sort(ptvOriginal.begin(), ptvOriginal.end(), PointSmallerXCompare());
+	}
+
+	// every pass that does not end the loop puts back at least one point;
+	// with every point back the curve is the original one, so the loop ends
+	while (!ptvOriginal.empty()) {
+		ptvKept.clear();
+		ivKept.clear();
+		for (int i = 0; i < iCtrlPtCount; ++i) {
+			if (bvKeep[i]) {
+				ptvKept.push_back(m_ptvCtrlPts[i]);
+				ivKept.push_back(i);
+			}
+		}
+
+		m_pceEvaluator->evaluateCurve(ptvKept, ptvEvaluated, m_fMaxX, m_bWrap);
+		std::sort(ptvEvaluated.begin(), ptvEvaluated.end(), PointSmallerXCompare());
+		if (ptvEvaluated.empty())
+			break;
+
+		// worst sample of each span between two kept points, samples outside
+		// the kept points count to the first or last span
+		const int iSpanCount = ivKept.size() - 1;
+		std::vector<float> fvWorst(iSpanCount, fTolerance);
+		std::vector<float> fvWorstX(iSpanCount, 0.0f);
+
+		int iSpan = 0;
+		int iEvalPt = 0;
+		for (int i = 0; i < ptvOriginal.size(); ++i) {
+			const float x = ptvOriginal[i].x;
+			while (iSpan + 1 < iSpanCount && m_ptvCtrlPts[ivKept[iSpan + 1]].x <= x)
+				++iSpan;
+
+			const float fError = fabs(evaluated_y(ptvEvaluated, iEvalPt, x) - ptvOriginal[i].y);
+			if (fError > fvWorst[iSpan]) {
+				fvWorst[iSpan] = fError;
+				fvWorstX[iSpan] = x;
+			}
+		}
+
+		bool bRefined = false;
+		for (iSpan = 0; iSpan < iSpanCount; ++iSpan) {
+			if (fvWorst[iSpan] <= fTolerance)
+				continue;
+
+			// dropped point of the span closest to the worst sample; a span
+			// without one takes the closest dropped point of the whole curve
+			int iFirst = ivKept[iSpan] + 1;
+			int iLast = ivKept[iSpan + 1] - 1;
+			if (iFirst > iLast) {
+				iFirst = 0;
+				iLast = iCtrlPtCount - 1;
+			}
+
+			int iClosest = -1;
+			float fClosest = FLT_MAX;
+			for (int i = iFirst; i <= iLast; ++i) {
+				const float fDist = fabs(m_ptvCtrlPts[i].x - fvWorstX[iSpan]);
+				if (!bvKeep[i] && fDist < fClosest) {
+					fClosest = fDist;
+					iClosest = i;
+				}
+			}
+
+			if (iClosest >= 0) {
+				bvKeep[iClosest] = true;
+				bRefined = true;
+			}
+		}
+
+		if (!bRefined)
+			break;
+	}
+
+	std::vector<Point> ptvSimplified;
+	for (int i = 0; i < iCtrlPtCount; ++i) {
+		if (bvKeep[i])
+			ptvSimplified.push_back(m_ptvCtrlPts[i]);
+	}
+
+	m_ptvCtrlPts.swap(ptvSimplified);
+	m_bDirty = true;
+
+	return iCtrlPtCount - m_ptvCtrlPts.size();
+}
+
 void Curve::sortControlPoints() const
 {
 	std::sort(m_ptvCtrlPts.begin(),
@@ -423,6 +609,7 @@ void Curve::reevaluate() const
 				m_ptvEvaluatedCurvePts.end(),
 				PointSmallerXCompare());
 
+			m_fvBakedSamples.clear();
 			m_bDirty = false;
 		}
 	}
@@ -433,6 +620,79 @@ void Curve::invalidate() const
 	m_bDirty = true;
 }
 
+// sample the curve at every frame in [0, maxX] with a single sweep
+// over the evaluated points, same interpolation as evaluateCurveAt()
+void Curve::bake(const float fFps) const
+{
+	reevaluate();
+
+	const int iFrameCount = (int)(m_fMaxX * fFps + 0.001f) + 1;
+
+	m_fBakedFps = fFps;
+	m_fvBakedSamples.resize(iFrameCount);
+
+	const int iPtCount = m_ptvEvaluatedCurvePts.size();
+
+	if (iPtCount == 0) {
+		std::fill(m_fvBakedSamples.begin(), m_fvBakedSamples.end(), 0.0f);
+		return;
+	}
+	if (iPtCount == 1) {
+		std::fill(m_fvBakedSamples.begin(), m_fvBakedSamples.end(), m_ptvEvaluatedCurvePts[0].y);
+		return;
+	}
+
+	const Point& ptFirst = m_ptvEvaluatedCurvePts[0];
+	const Point& ptLast = m_ptvEvaluatedCurvePts[iPtCount - 1];
+	int iPt = 0;
+
+	for (int iFrame = 0; iFrame < iFrameCount; ++iFrame) {
+		const float x = (float)iFrame / fFps;
+
+		if (ptFirst.x > x) {
+			m_fvBakedSamples[iFrame] = ptFirst.y;
+			continue;
+		}
+		if (ptLast.x < x) {
+			m_fvBakedSamples[iFrame] = ptLast.y;
+			continue;
+		}
+
+		while (m_ptvEvaluatedCurvePts[iPt + 1].x < x)
+			++iPt;
+
+		const Point& point_one = m_ptvEvaluatedCurvePts[iPt];
+		const Point& point_two = m_ptvEvaluatedCurvePts[iPt + 1];
+
+		if (point_one.x == point_two.x)
+			m_fvBakedSamples[iFrame] = point_one.y;
+		else {
+			float slope = (point_two.y - point_one.y) / (point_two.x - point_one.x);
+			m_fvBakedSamples[iFrame] = (x - point_one.x) * slope + point_one.y;
+		}
+	}
+}
+
+float Curve::sampleAt(const int iFrame, const float fFps) const
+{
+	// re-evaluation drops a stale table
+	reevaluate();
+
+	if (m_fvBakedSamples.empty() || m_fBakedFps != fFps)
+		bake(fFps);
+
+	if (iFrame <= 0)
+		return m_fvBakedSamples[0];
+	if (iFrame >= m_fvBakedSamples.size())
+		return m_fvBakedSamples[m_fvBakedSamples.size() - 1];
+	return m_fvBakedSamples[iFrame];
+}
+
+int Curve::bakedFrameCount() const
+{
+	return m_fvBakedSamples.size();
+}
+
 std::ostream& operator<<(std::ostream& output_stream, const Curve & curve_data)
 {
 	curve_data.toStream(output_stream);
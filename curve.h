@@ -49,13 +49,24 @@ public:
 	void drawControlPoint(int iCtrlPt) const;
 	void drawCurve(void) const;
 	void invalidate(void) const;
+	bool dirty(void) const { return m_bDirty; }
+	// re-tessellate now if dirty, otherwise done lazily on first access
+	void reevaluate(void) const;
+
+	// baked samples at a fixed frame rate, rebuilt lazily whenever the curve is re-evaluated
+	void bake(const float fFps) const;
+	float sampleAt(const int iFrame, const float fFps) const;
+	int bakedFrameCount(void) const;
+
+	// drop control points while the evaluated curve stays within fTolerance (in y)
+	// of the original evaluated curve, returns the number of points removed
+	int simplify(const float fTolerance);
 
 	void toStream(std::ostream& output_stream) const;
 	void fromStream(std::istream& input_stream);
 
 protected:
 	void init(const float fStartYValue = 0.0f);
-	void reevaluate(void) const;
 	// this must be called when a control point is added
 	void sortControlPoints(void) const;
 
@@ -64,6 +75,8 @@ protected:
 	mutable std::vector<Point> m_ptvCtrlPts;
 	mutable std::vector<Point> m_ptvEvaluatedCurvePts;
 	mutable bool m_bDirty;
+	mutable std::vector<float> m_fvBakedSamples;
+	mutable float m_fBakedFps;
 
 	float m_fMaxX;
 	bool m_bWrap;
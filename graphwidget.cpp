@@ -25,6 +25,7 @@
 #include "GraphWidget.h"
 
 #include "LinearCurveEvaluator.h"
+#include "parallel.h"
  
 
 #define LEFT		1
@@ -119,8 +120,7 @@ m_flcCurrCurve(FL_BLACK)
 	m_ppceCurveEvaluators[CURVE_TYPE_BSPLINE]		= new BSplineCurveEvaluator();
 	m_ppceCurveEvaluators[CURVE_TYPE_BEZIER]		= new BezierCurveEvaluator();
 	m_ppceCurveEvaluators[CURVE_TYPE_CATMULLROM]	= new CatmullRomCurveEvaluator();
-	// Note that C2-Interpolating curve is not a requirement
-	m_ppceCurveEvaluators[CURVE_TYPE_C2INTERPOLATING] = new LinearCurveEvaluator();
+	m_ppceCurveEvaluators[CURVE_TYPE_C2INTERPOLATING] = new C2InterpolatingCurveEvaluator();
 
 }
 
@@ -500,6 +500,12 @@ float GraphWidget::endTime() const
 }
 
 void GraphWidget::endTime(const float fEndTime)
+{
+	setEndTime(fEndTime);
+	reevaluateAll();
+}
+
+void GraphWidget::setEndTime(const float fEndTime)
 {
 	if (fEndTime > 0.0) {
 		m_fEndTime = fEndTime;
@@ -516,6 +522,7 @@ void GraphWidget::scaleTime(const float fScale)
 		m_pcrvvCurves[i]->scaleX(fScale);
 	}
 	invalidateAllCurves();
+	reevaluateAll();
 }
 
 void GraphWidget::selectCurrCurve(const int iMouseX, const int iMouseY)
@@ -858,11 +865,61 @@ void GraphWidget::invalidateAllCurves()
 		m_pcrvvCurves[i]->invalidate();
 }
 
+void GraphWidget::reevaluateAll()
+{
+	// curves share nothing but their const evaluator, so each one
+	// can be tessellated on its own thread
+	std::vector<const Curve*> pcrvvDirty;
+	for (int i = 0; i < m_pcrvvCurves.size(); ++i) {
+		if (m_pcrvvCurves[i]->dirty())
+			pcrvvDirty.push_back(m_pcrvvCurves[i]);
+	}
+
+	parallelFor(pcrvvDirty.size(), [&pcrvvDirty](int i) {
+		pcrvvDirty[i]->reevaluate();
+	});
+}
+
 const Curve* GraphWidget::curve(int iCurve) const
 {
 	return m_pcrvvCurves[iCurve];
 }
 
+int GraphWidget::simplifyCurves(const float fTolerance)
+{
+	std::vector<int> ivRemoved(m_pcrvvCurves.size(), 0);
+
+	parallelFor(m_pcrvvCurves.size(), [&](int i) {
+		ivRemoved[i] = m_pcrvvCurves[i]->simplify(fTolerance * m_cdvCurveDomains[i].mag());
+	});
+
+	int iRemoved = 0;
+	for (int i = 0; i < ivRemoved.size(); ++i)
+		iRemoved += ivRemoved[i];
+
+	// selection indices no longer match
+	deselectCtrlPts();
+	reevaluateAll();
+
+	return iRemoved;
+}
+
+int GraphWidget::bakeCurves(const float fFps, std::vector<float>& fvTable) const
+{
+	const int iCurveCount = m_pcrvvCurves.size();
+	const int iFrameCount = (int)(m_fEndTime * fFps + 0.001f) + 1;
+
+	fvTable.resize(iFrameCount * iCurveCount);
+
+	for (int iCurve = 0; iCurve < iCurveCount; ++iCurve) {
+		const Curve* pcrv = m_pcrvvCurves[iCurve];
+		for (int iFrame = 0; iFrame < iFrameCount; ++iFrame)
+			fvTable[iFrame * iCurveCount + iCurve] = pcrv->sampleAt(iFrame, fFps);
+	}
+
+	return iFrameCount;
+}
+
 void GraphWidget::drawActiveCurves() const
 {
 	for (int i = m_ivActiveCurves.size() - 1; i >= 0; --i) {
@@ -1051,7 +1108,8 @@ bool GraphWidget::loadScript(const char* szFileName)
 		ifsFile >> fEndTime;
 		if (fEndTime <= 0.0f)
 			return false;
-		endTime(fEndTime);
+		// curves are re-evaluated once everything is read
+		setEndTime(fEndTime);
 
 		ifsFile >> iCurveCount;
 
@@ -1069,6 +1127,8 @@ bool GraphWidget::loadScript(const char* szFileName)
 			m_pcrvvCurves[i]->fromStream(ifsFile);
 		}
 
+		reevaluateAll();
+
 		return true;
 	}
 
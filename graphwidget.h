@@ -101,11 +101,19 @@ public:
 	int currCurveWrap() const;
 	void currCurveWrap(bool bWrap);
 	void invalidateAllCurves();
+	// re-tessellate every dirty curve across the worker threads
+	void reevaluateAll();
+	// reduce the control points of every curve, fTolerance is a fraction of
+	// each curve's value range, returns the number of points removed
+	int simplifyCurves(const float fTolerance);
 	// note that this value is evaluated lazily (it's only updated
 	// after a redraw.
 	Fl_Color currCurveColor() const { return m_flcCurrCurve; }
 
 	const Curve* curve(int iCurve) const;
+	// bake every curve at fFps into one frame-major table,
+	// fvTable[iFrame * curveCount + iCurve], returns the frame count
+	int bakeCurves(const float fFps, std::vector<float>& fvTable) const;
 	bool saveScript(const char* szFileName) const;
 	bool loadScript(const char* szFileName);
 
@@ -169,6 +177,7 @@ protected:
 	void doPan(const int iMouseDX, const int iMouseDY);
 
 	void curveType(int iCurve, int iCurveType);
+	void setEndTime(const float fEndTime);
 
 	Point curveToWindow(int iCurve, const Point& ptCurve) const;
 	Point windowToCurve(int iCurve, const Point& ptWindow) const;
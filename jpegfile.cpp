@@ -0,0 +1,108 @@
+//
+// jpegfile.cpp
+//
+// JPEG encoding into memory.  All state lives in the compress struct of
+// one call, so frames can be encoded on several threads at once.
+//
+
+#include "jpegfile.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+
+extern "C" {
+#include <jpeglib.h>
+}
+
+// libjpeg's default error handler exits the process, jump back instead
+struct JPEGError {
+	struct jpeg_error_mgr pub;
+	jmp_buf jbReturn;
+};
+
+// compressed bytes go straight into a std::vector
+struct JPEGDestination {
+	struct jpeg_destination_mgr pub;
+	std::vector<unsigned char>* pvOutput;
+};
+
+static void jpegErrorExit(j_common_ptr pInfo)
+{
+	longjmp(((JPEGError*)pInfo->err)->jbReturn, 1);
+}
+
+static void jpegInitDestination(j_compress_ptr pInfo)
+{
+	JPEGDestination* pDest = (JPEGDestination*)pInfo->dest;
+	std::vector<unsigned char>& vOutput = *pDest->pvOutput;
+
+	const size_t iSize = (vOutput.capacity() > 65536) ? vOutput.capacity() : 65536;
+	vOutput.resize(iSize);
+	pDest->pub.next_output_byte = &vOutput[0];
+	pDest->pub.free_in_buffer = iSize;
+}
+
+static boolean jpegEmptyOutputBuffer(j_compress_ptr pInfo)
+{
+	JPEGDestination* pDest = (JPEGDestination*)pInfo->dest;
+	std::vector<unsigned char>& vOutput = *pDest->pvOutput;
+
+	// libjpeg only calls this once the whole buffer is used
+	const size_t iUsed = vOutput.size();
+	vOutput.resize(iUsed * 2);
+	pDest->pub.next_output_byte = &vOutput[iUsed];
+	pDest->pub.free_in_buffer = iUsed;
+	return TRUE;
+}
+
+static void jpegTermDestination(j_compress_ptr pInfo)
+{
+	JPEGDestination* pDest = (JPEGDestination*)pInfo->dest;
+	pDest->pvOutput->resize(pDest->pvOutput->size() - pDest->pub.free_in_buffer);
+}
+
+bool encodeJPEG(int iWidth, int iHeight, const unsigned char* pbyData, int iQuality, std::vector<unsigned char>& vOutput)
+{
+	if (iWidth <= 0 || iHeight <= 0)
+		return false;
+	if (iQuality < 1) iQuality = 1;
+	if (iQuality > 100) iQuality = 100;
+
+	struct jpeg_compress_struct info;
+	JPEGError error;
+	JPEGDestination dest;
+
+	info.err = jpeg_std_error(&error.pub);
+	error.pub.error_exit = jpegErrorExit;
+	if (setjmp(error.jbReturn)) {
+		jpeg_destroy_compress(&info);
+		vOutput.clear();
+		return false;
+	}
+
+	jpeg_create_compress(&info);
+
+	dest.pub.init_destination = jpegInitDestination;
+	dest.pub.empty_output_buffer = jpegEmptyOutputBuffer;
+	dest.pub.term_destination = jpegTermDestination;
+	dest.pvOutput = &vOutput;
+	info.dest = &dest.pub;
+
+	info.image_width = iWidth;
+	info.image_height = iHeight;
+	info.input_components = 3;
+	info.in_color_space = JCS_RGB;
+	jpeg_set_defaults(&info);
+	jpeg_set_quality(&info, iQuality, TRUE);
+
+	jpeg_start_compress(&info, TRUE);
+	// JPEG stores rows top-down, the GL readback is bottom-up
+	while (info.next_scanline < info.image_height) {
+		JSAMPROW pRow = (JSAMPROW)(pbyData + (iHeight - 1 - info.next_scanline) * 3 * iWidth);
+		jpeg_write_scanlines(&info, &pRow, 1);
+	}
+	jpeg_finish_compress(&info);
+	jpeg_destroy_compress(&info);
+
+	return true;
+}
@@ -0,0 +1,17 @@
+//
+// jpegfile.h
+//
+// header file for JPEG encoding, through the libjpeg bundled with fltk
+//
+
+#ifndef JPEGFILE_H
+#define JPEGFILE_H
+
+#include <vector>
+
+// encode bottom-up RGB rows, the layout writeBMP() takes, as a baseline
+// JPEG into vOutput; iQuality runs from 1 (smallest) to 100 (best).
+// vOutput keeps its capacity, so reusing it avoids reallocating per frame
+extern bool encodeJPEG(int iWidth, int iHeight, const unsigned char *pbyData, int iQuality, std::vector<unsigned char>& vOutput);
+
+#endif
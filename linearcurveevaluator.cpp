@@ -1,5 +1,7 @@
 #include "LinearCurveEvaluator.h"
+#include "SplineKernel.h"
 #include <assert.h>
+#include <algorithm>
 
 
 // Static Function Prototype
@@ -15,13 +17,8 @@ static void evaluate_bezier(
 	const float& fAniLength,
 	const bool& bWrap);
 
-static void evaluate_bspline(
-	const std::vector<Point>& ptvCtrlPts,
-	std::vector<Point>& ptvEvaluatedCurvePts,
-	const float& fAniLength,
-	const bool& bWrap);
-
-static void evaluate_catmullrom(
+template <class Basis>
+static void evaluate_spline(
 	const std::vector<Point>& ptvCtrlPts,
 	std::vector<Point>& ptvEvaluatedCurvePts,
 	const float& fAniLength,
@@ -47,19 +44,13 @@ static void draw_bezier(
 	const Point& pt_1, const Point& pt_2, const Point& pt_3, const Point& pt_4,
 	std::vector<Point>& ptvEvaluatedCurvePts, int depth, float wrap_x);
 
-static void draw_bspline(
-	const Point& pt_1, const Point& pt_2, const Point& pt_3, const Point& pt_4,
-	std::vector<Point>& ptvEvaluatedCurvePts, int depth);
-
-static void draw_bspline(
-	const Point& pt_1, const Point& pt_2, const Point& pt_3, const Point& pt_4,
-	std::vector<Point>& ptvEvaluatedCurvePts, int depth, float wrap_x);
-
-static void draw_catmullrom(
+template <class Basis>
+static void draw_spline(
 	const Point& pt_1, const Point& pt_2, const Point& pt_3, const Point& pt_4,
 	std::vector<Point>& ptvEvaluatedCurvePts, int depth);
 
-static void draw_catmullrom(
+template <class Basis>
+static void draw_spline(
 	const Point& pt_1, const Point& pt_2, const Point& pt_3, const Point& pt_4,
 	std::vector<Point>& ptvEvaluatedCurvePts, int depth, float wrap_x);
 
@@ -73,6 +64,54 @@ static void subdivide(
 
 static void midpoint(Point &dst, const Point& src_1, const Point& src_2);
 
+static void evaluate_c2interpolating(
+	const std::vector<Point>& ptvCtrlPts,
+	std::vector<Point>& ptvEvaluatedCurvePts,
+	const float& fAniLength,
+	const bool& bWrap,
+	const bool& bClamped);
+
+static void solve_tridiagonal(
+	const int size,
+	const double* a, const double* b, const double* c, const double* r,
+	double* x, double* buffer);
+
+static void solve_cyclic_tridiagonal(
+	const int size,
+	const double* a, double* b, const double* c, const double* r,
+	double* x, double* z, double* buffer);
+
+static float c2_segment_value(
+	const Point& pt_1, const Point& pt_2, const double m_1, const double m_2, const double h,
+	const float x);
+
+
+// C2 Solver Scratch
+// kept per thread and only grown, so that re-evaluating a curve does not allocate
+struct C2Scratch {
+	std::vector<double> h;
+	std::vector<double> a;
+	std::vector<double> b;
+	std::vector<double> c;
+	std::vector<double> r;
+	std::vector<double> m;
+	std::vector<double> z;
+	std::vector<double> buffer;
+
+	void resize(int size) {
+		h.resize(size);
+		a.resize(size);
+		b.resize(size);
+		c.resize(size);
+		r.resize(size);
+		m.resize(size);
+		z.resize(size);
+		buffer.resize(size);
+	}
+};
+
+static thread_local C2Scratch s_c2_scratch;
+
 
 // Operation Handling
 void LinearCurveEvaluator::evaluateCurve(
@@ -112,7 +151,7 @@ void BSplineCurveEvaluator::evaluateCurve(
 	const bool& bWrap) const {
 
 	ptvEvaluatedCurvePts.clear();
-	evaluate_bspline(ptvCtrlPts, ptvEvaluatedCurvePts, fAniLength, bWrap);
+	evaluate_spline<BSplineBasis>(ptvCtrlPts, ptvEvaluatedCurvePts, fAniLength, bWrap);
 }
 
 
@@ -123,7 +162,34 @@ void CatmullRomCurveEvaluator::evaluateCurve(
 	const bool& bWrap) const {
 
 	ptvEvaluatedCurvePts.clear();
-	evaluate_catmullrom(ptvCtrlPts, ptvEvaluatedCurvePts, fAniLength, bWrap);
+	evaluate_spline<CatmullRomBasis<> >(ptvCtrlPts, ptvEvaluatedCurvePts, fAniLength, bWrap);
+}
+
+
+C2InterpolatingCurveEvaluator::C2InterpolatingCurveEvaluator(bool bClamped) :
+m_bClamped(bClamped)
+{
+}
+
+
+void C2InterpolatingCurveEvaluator::evaluateCurve(
+	const std::vector<Point>& ptvCtrlPts,
+	std::vector<Point>& ptvEvaluatedCurvePts,
+	const float& fAniLength,
+	const bool& bWrap) const {
+
+	// cyclic system needs at least 3 unknowns
+	if (bWrap && ptvCtrlPts.size() < 3) {
+		evaluate_line(ptvCtrlPts, ptvEvaluatedCurvePts, fAniLength, bWrap);
+		return;
+	}
+	else if (!bWrap && ptvCtrlPts.size() < 2) {
+		evaluate_line(ptvCtrlPts, ptvEvaluatedCurvePts, fAniLength, bWrap);
+		return;
+	}
+
+	ptvEvaluatedCurvePts.clear();
+	evaluate_c2interpolating(ptvCtrlPts, ptvEvaluatedCurvePts, fAniLength, bWrap, m_bClamped);
 }
 
 
@@ -229,7 +295,8 @@ static void evaluate_bezier(
 	}
 }
 
-static void evaluate_bspline(
+template <class Basis>
+static void evaluate_spline(
 	const std::vector<Point>& ptvCtrlPts,
 	std::vector<Point>& ptvEvaluatedCurvePts,
 	const float& fAniLength,
@@ -255,21 +322,21 @@ static void evaluate_bspline(
 			pt_temp_4 = Point(ptvCtrlPts[2].x + fAniLength, ptvCtrlPts[2].y);
 		}
 
-		draw_bspline(
+		draw_spline<Basis>(
 			pt_temp_1, 
 			Point(ptvCtrlPts[pt_size - 2].x - fAniLength, ptvCtrlPts[pt_size - 2].y), 
 			Point(ptvCtrlPts[pt_size - 1].x - fAniLength, ptvCtrlPts[pt_size - 1].y), 
 			ptvCtrlPts[0], 
 			ptvEvaluatedCurvePts, 10);
 		
-		draw_bspline(
+		draw_spline<Basis>(
 			Point(ptvCtrlPts[pt_size - 2].x - fAniLength, ptvCtrlPts[pt_size - 2].y),
 			Point(ptvCtrlPts[pt_size - 1].x - fAniLength, ptvCtrlPts[pt_size - 1].y), 
 			ptvCtrlPts[0], 
 			ptvCtrlPts[1], 
 			ptvEvaluatedCurvePts, 10);
 
-		draw_bspline(
+		draw_spline<Basis>(
 			Point(ptvCtrlPts[pt_size - 1].x - fAniLength, ptvCtrlPts[pt_size - 1].y),
 			ptvCtrlPts[0], 
 			ptvCtrlPts[1], 
@@ -278,26 +345,26 @@ static void evaluate_bspline(
 
 		int i;
 		for (i = 0; i < (int)(ptvCtrlPts.size()) - 3; i++) {
-			draw_bspline(
+			draw_spline<Basis>(
 				ptvCtrlPts[i + 0], ptvCtrlPts[i + 1], ptvCtrlPts[i + 2], ptvCtrlPts[i + 3],
 				ptvEvaluatedCurvePts, 10);
 		}
 
-		draw_bspline(
+		draw_spline<Basis>(
 			pt_temp_3,
 			ptvCtrlPts[pt_size - 2],
 			ptvCtrlPts[pt_size - 1],
 			Point(ptvCtrlPts[0].x + fAniLength, ptvCtrlPts[0].y),
 			ptvEvaluatedCurvePts, 10);
 
-		draw_bspline(
+		draw_spline<Basis>(
 			ptvCtrlPts[pt_size - 2],
 			ptvCtrlPts[pt_size - 1],
 			Point(ptvCtrlPts[0].x + fAniLength, ptvCtrlPts[0].y),
 			Point(ptvCtrlPts[1].x + fAniLength, ptvCtrlPts[1].y),
 			ptvEvaluatedCurvePts, 10);
 
-		draw_bspline(
+		draw_spline<Basis>(
 			ptvCtrlPts[pt_size - 1],
 			Point(ptvCtrlPts[0].x + fAniLength, ptvCtrlPts[0].y),
 			Point(ptvCtrlPts[1].x + fAniLength, ptvCtrlPts[1].y),
@@ -311,135 +378,29 @@ static void evaluate_bspline(
 		draw_point(Point(0, ptvCtrlPts[0].y), ptvEvaluatedCurvePts);
 
 		// start curve
-		if (ptvCtrlPts.size() < 3)	draw_bspline(Point(ptvCtrlPts[ptvCtrlPts.size() - 1].x - fAniLength, ptvCtrlPts[ptvCtrlPts.size() - 1].y), ptvCtrlPts[0], ptvCtrlPts[1], Point(fAniLength, ptvCtrlPts[0].y), ptvEvaluatedCurvePts, 10);
-		else						draw_bspline(Point(ptvCtrlPts[ptvCtrlPts.size() - 1].x - fAniLength, ptvCtrlPts[ptvCtrlPts.size() - 1].y), ptvCtrlPts[0], ptvCtrlPts[1], ptvCtrlPts[2], ptvEvaluatedCurvePts, 10);
+		if (ptvCtrlPts.size() < 3)	draw_spline<Basis>(Point(ptvCtrlPts[ptvCtrlPts.size() - 1].x - fAniLength, ptvCtrlPts[ptvCtrlPts.size() - 1].y), ptvCtrlPts[0], ptvCtrlPts[1], Point(fAniLength, ptvCtrlPts[0].y), ptvEvaluatedCurvePts, 10);
+		else						draw_spline<Basis>(Point(ptvCtrlPts[ptvCtrlPts.size() - 1].x - fAniLength, ptvCtrlPts[ptvCtrlPts.size() - 1].y), ptvCtrlPts[0], ptvCtrlPts[1], ptvCtrlPts[2], ptvEvaluatedCurvePts, 10);
 
 		// middle curve
 		int i;
 		for (i = 0; i < (int)(ptvCtrlPts.size()) - 3; i++) {
-			draw_bspline(
+			draw_spline<Basis>(
 				ptvCtrlPts[i + 0], ptvCtrlPts[i + 1], ptvCtrlPts[i + 2], ptvCtrlPts[i + 3],
 				ptvEvaluatedCurvePts, 10);
 		}
 
 		// end curve
-		if (ptvCtrlPts.size() >= 3)	draw_bspline(ptvCtrlPts[ptvCtrlPts.size() - 3], 
-												 ptvCtrlPts[ptvCtrlPts.size() - 2], 
-												 ptvCtrlPts[ptvCtrlPts.size() - 1],
-												 Point(ptvCtrlPts[0].x + fAniLength, ptvCtrlPts[0].y),
-												 ptvEvaluatedCurvePts, 10);
+		if (ptvCtrlPts.size() >= 3)	draw_spline<Basis>(ptvCtrlPts[ptvCtrlPts.size() - 3], 
+																ptvCtrlPts[ptvCtrlPts.size() - 2], 
+																ptvCtrlPts[ptvCtrlPts.size() - 1],
+																Point(ptvCtrlPts[0].x + fAniLength, ptvCtrlPts[0].y),
+																ptvEvaluatedCurvePts, 10);
 
 		// end point
 		draw_point(Point(fAniLength, ptvCtrlPts[ptvCtrlPts.size() - 1].y), ptvEvaluatedCurvePts);
 	}
 }
 
-static void evaluate_catmullrom(
-	const std::vector<Point>& ptvCtrlPts,
-	std::vector<Point>& ptvEvaluatedCurvePts,
-	const float& fAniLength,
-	const bool& bWrap) {
-
-	// variable
-	const int pt_size = ptvCtrlPts.size();
-	Point pt_temp_1, pt_temp_2, pt_temp_3, pt_temp_4;
-
-	// wrap
-	if (bWrap) {
-
-		if (pt_size < 3) {
-			pt_temp_1 = Point(ptvCtrlPts[0].x - fAniLength, ptvCtrlPts[0].y);
-			pt_temp_2 = Point(ptvCtrlPts[0].x + fAniLength, ptvCtrlPts[0].y);
-			pt_temp_3 = Point(ptvCtrlPts[pt_size - 1].x - fAniLength, ptvCtrlPts[pt_size - 1].y);
-			pt_temp_4 = Point(ptvCtrlPts[pt_size - 1].x + fAniLength, ptvCtrlPts[pt_size - 1].y);
-		}
-		else {
-			pt_temp_1 = Point(ptvCtrlPts[pt_size - 3].x - fAniLength, ptvCtrlPts[pt_size - 3].y);
-			pt_temp_2 = ptvCtrlPts[2];
-			pt_temp_3 = Point(ptvCtrlPts[pt_size - 3]);
-			pt_temp_4 = Point(ptvCtrlPts[2].x + fAniLength, ptvCtrlPts[2].y);
-		}
-
-		draw_catmullrom(
-			pt_temp_1,
-			Point(ptvCtrlPts[pt_size - 2].x - fAniLength, ptvCtrlPts[pt_size - 2].y),
-			Point(ptvCtrlPts[pt_size - 1].x - fAniLength, ptvCtrlPts[pt_size - 1].y),
-			ptvCtrlPts[0],
-			ptvEvaluatedCurvePts, 10);
-
-		draw_catmullrom(
-			Point(ptvCtrlPts[pt_size - 2].x - fAniLength, ptvCtrlPts[pt_size - 2].y),
-			Point(ptvCtrlPts[pt_size - 1].x - fAniLength, ptvCtrlPts[pt_size - 1].y),
-			ptvCtrlPts[0],
-			ptvCtrlPts[1],
-			ptvEvaluatedCurvePts, 10);
-
-		draw_catmullrom(
-			Point(ptvCtrlPts[pt_size - 1].x - fAniLength, ptvCtrlPts[pt_size - 1].y),
-			ptvCtrlPts[0],
-			ptvCtrlPts[1],
-			pt_temp_2,
-			ptvEvaluatedCurvePts, 10);
-
-		int i;
-		for (i = 0; i < (int)(ptvCtrlPts.size()) - 3; i++) {
-			draw_catmullrom(
-				ptvCtrlPts[i + 0], ptvCtrlPts[i + 1], ptvCtrlPts[i + 2], ptvCtrlPts[i + 3],
-				ptvEvaluatedCurvePts, 10);
-		}
-
-		draw_catmullrom(
-			pt_temp_3,
-			ptvCtrlPts[pt_size - 2],
-			ptvCtrlPts[pt_size - 1],
-			Point(ptvCtrlPts[0].x + fAniLength, ptvCtrlPts[0].y),
-			ptvEvaluatedCurvePts, 10);
-
-		draw_catmullrom(
-			ptvCtrlPts[pt_size - 2],
-			ptvCtrlPts[pt_size - 1],
-			Point(ptvCtrlPts[0].x + fAniLength, ptvCtrlPts[0].y),
-			Point(ptvCtrlPts[1].x + fAniLength, ptvCtrlPts[1].y),
-			ptvEvaluatedCurvePts, 10);
-
-		draw_catmullrom(
-			ptvCtrlPts[pt_size - 1],
-			Point(ptvCtrlPts[0].x + fAniLength, ptvCtrlPts[0].y),
-			Point(ptvCtrlPts[1].x + fAniLength, ptvCtrlPts[1].y),
-			pt_temp_4,
-			ptvEvaluatedCurvePts, 10);
-
-	}
-	else {
-
-		// start point
-		draw_point(Point(0, ptvCtrlPts[0].y), ptvEvaluatedCurvePts);
-
-		// start curve
-		if (ptvCtrlPts.size() < 3)	draw_catmullrom(Point(ptvCtrlPts[ptvCtrlPts.size() - 1].x - fAniLength, ptvCtrlPts[ptvCtrlPts.size() - 1].y), ptvCtrlPts[0], ptvCtrlPts[1], Point(fAniLength, ptvCtrlPts[0].y), ptvEvaluatedCurvePts, 10);
-		else						draw_catmullrom(Point(ptvCtrlPts[ptvCtrlPts.size() - 1].x - fAniLength, ptvCtrlPts[ptvCtrlPts.size() - 1].y), ptvCtrlPts[0], ptvCtrlPts[1], ptvCtrlPts[2], ptvEvaluatedCurvePts, 10);
-
-		// middle curve
-		int i;
-		for (i = 0; i < (int)(ptvCtrlPts.size()) - 3; i++) {
-			draw_catmullrom(
-				ptvCtrlPts[i + 0], ptvCtrlPts[i + 1], ptvCtrlPts[i + 2], ptvCtrlPts[i + 3],
-				ptvEvaluatedCurvePts, 10);
-		}
-
-		// end curve
-		if (ptvCtrlPts.size() >= 3)	draw_catmullrom(ptvCtrlPts[ptvCtrlPts.size() - 3],
-			ptvCtrlPts[ptvCtrlPts.size() - 2],
-			ptvCtrlPts[ptvCtrlPts.size() - 1],
-			Point(ptvCtrlPts[0].x + fAniLength, ptvCtrlPts[0].y),
-			ptvEvaluatedCurvePts, 10);
-
-		// end point
-		draw_point(Point(fAniLength, ptvCtrlPts[ptvCtrlPts.size() - 1].y), ptvEvaluatedCurvePts);
-	}
-
-}
-
 
 static void draw_bezier(
 	const Point& pt_1, const Point& pt_2, const Point& pt_3, const Point& pt_4,
@@ -529,61 +490,30 @@ static void draw_bezier(
 }
 
 
-static void draw_bspline(
-	const Point& pt_1, const Point& pt_2, const Point& pt_3, const Point& pt_4,
-	std::vector<Point>& ptvEvaluatedCurvePts, int depth) {
-
-	draw_bspline(pt_1, pt_2, pt_3, pt_4, ptvEvaluatedCurvePts, depth, -1);
-}
-
-
-static void draw_bspline(
-	const Point& pt_1, const Point& pt_2, const Point& pt_3, const Point& pt_4,
-	std::vector<Point>& ptvEvaluatedCurvePts, int depth, float wrap_x) {
-
-	Point pt_temp_1 = pt_1 * 1 + pt_2 * 4 + pt_3 * 1;
-	Point pt_temp_2 = pt_2 * 4 + pt_3 * 2;
-	Point pt_temp_3 = pt_2 * 2 + pt_3 * 4;
-	Point pt_temp_4 = pt_2 * 1 + pt_3 * 4 + pt_4 * 1;
-
-	pt_temp_1 /= 6;
-	pt_temp_2 /= 6;
-	pt_temp_3 /= 6;
-	pt_temp_4 /= 6;
-
-	draw_bezier(pt_temp_1, pt_temp_2, pt_temp_3, pt_temp_4, ptvEvaluatedCurvePts, depth, wrap_x);
-}
-
-
-
-static void draw_catmullrom(
+template <class Basis>
+static void draw_spline(
 	const Point& pt_1, const Point& pt_2, const Point& pt_3, const Point& pt_4,
 	std::vector<Point>& ptvEvaluatedCurvePts, int depth) {
 
-	draw_catmullrom(pt_1, pt_2, pt_3, pt_4, ptvEvaluatedCurvePts, depth, -1);
+	draw_spline<Basis>(pt_1, pt_2, pt_3, pt_4, ptvEvaluatedCurvePts, depth, -1);
 }
 
 
-
-static void draw_catmullrom(
+template <class Basis>
+static void draw_spline(
 	const Point& pt_1, const Point& pt_2, const Point& pt_3, const Point& pt_4,
 	std::vector<Point>& ptvEvaluatedCurvePts, int depth, float wrap_x) {
 
-	draw_point(pt_2, ptvEvaluatedCurvePts);
-
-	Point pt_tangent_1 = Point(pt_3.x - pt_1.x, pt_3.y - pt_1.y);
-	Point pt_tangent_2 = Point(pt_4.x - pt_2.x, pt_4.y - pt_2.y);
+	Point pt_bezier[4];
+	SplineKernel<Basis>::toBezier(
+		pt_1, pt_2, pt_3, pt_4,
+		pt_bezier[0], pt_bezier[1], pt_bezier[2], pt_bezier[3]);
 
-	pt_tangent_1 /= 6;
-	pt_tangent_2 /= 6;
+	if (Basis::knot) draw_point(pt_2, ptvEvaluatedCurvePts);
 
-	draw_bezier(
-		pt_2, 
-		Point(pt_2.x + pt_tangent_1.x, pt_2.y + pt_tangent_1.y), 
-		Point(pt_3.x - pt_tangent_2.x, pt_3.y - pt_tangent_2.y), 
-		pt_3, ptvEvaluatedCurvePts, depth, wrap_x);
+	draw_bezier(pt_bezier[0], pt_bezier[1], pt_bezier[2], pt_bezier[3], ptvEvaluatedCurvePts, depth, wrap_x);
 
-	draw_point(pt_3, ptvEvaluatedCurvePts);
+	if (Basis::knot) draw_point(pt_3, ptvEvaluatedCurvePts);
 }
 
 
@@ -625,3 +555,193 @@ static void midpoint(Point& dst, const Point& src_1, const Point& src_2) {
 	dst.x = (src_1.x + src_2.x) / 2;
 	dst.y = (src_1.y + src_2.y) / 2;
 }
+
+
+static void evaluate_c2interpolating(
+	const std::vector<Point>& ptvCtrlPts,
+	std::vector<Point>& ptvEvaluatedCurvePts,
+	const float& fAniLength,
+	const bool& bWrap,
+	const bool& bClamped) {
+
+	// variable
+	const int		pt_size		= ptvCtrlPts.size();
+	const int		seg_count	= CurveEvaluator::s_iSegCount;
+	const double	h_min		= 0.0001;
+	C2Scratch&		scratch		= s_c2_scratch;
+
+	scratch.resize(pt_size);
+	double* h = scratch.h.data();
+	double* a = scratch.a.data();
+	double* b = scratch.b.data();
+	double* c = scratch.c.data();
+	double* r = scratch.r.data();
+	double* m = scratch.m.data();
+
+	ptvEvaluatedCurvePts.reserve(pt_size * seg_count + 4);
+
+	// wrap
+	// unknowns are the second derivatives at every control point,
+	// the segment after the last point joins the first point shifted by fAniLength
+	if (bWrap) {
+
+		for (int i = 0; i < pt_size - 1; i++) h[i] = std::max<double>(ptvCtrlPts[i + 1].x - ptvCtrlPts[i].x, h_min);
+		h[pt_size - 1] = std::max<double>(ptvCtrlPts[0].x + fAniLength - ptvCtrlPts[pt_size - 1].x, h_min);
+
+		for (int i = 0; i < pt_size; i++) {
+			const int i_prev = (i + pt_size - 1) % pt_size;
+			const int i_next = (i + 1) % pt_size;
+
+			a[i] = h[i_prev];
+			b[i] = 2 * (h[i_prev] + h[i]);
+			c[i] = h[i];
+			r[i] = 6 * ((ptvCtrlPts[i_next].y - ptvCtrlPts[i].y) / h[i] - (ptvCtrlPts[i].y - ptvCtrlPts[i_prev].y) / h[i_prev]);
+		}
+
+		solve_cyclic_tridiagonal(pt_size, a, b, c, r, m, scratch.z.data(), scratch.buffer.data());
+
+		// segment
+		for (int i = 0; i < pt_size; i++) {
+			const int	i_next	= (i + 1) % pt_size;
+			const Point	pt_1	= ptvCtrlPts[i];
+			const Point	pt_2	= (i_next == 0) ? Point(ptvCtrlPts[0].x + fAniLength, ptvCtrlPts[0].y) : ptvCtrlPts[i_next];
+
+			for (int k = 0; k < seg_count; k++) {
+				const float x = pt_1.x + (float)(h[i] * k / seg_count);
+				const float y = c2_segment_value(pt_1, pt_2, m[i], m[i_next], h[i], x);
+
+				if (x > fAniLength)	ptvEvaluatedCurvePts.push_back(Point(x - fAniLength, y));
+				else				ptvEvaluatedCurvePts.push_back(Point(x, y));
+			}
+		}
+
+		// start point and end point, both lie on the wrapping segment
+		const Point pt_last		= ptvCtrlPts[pt_size - 1];
+		const Point pt_first	= Point(ptvCtrlPts[0].x + fAniLength, ptvCtrlPts[0].y);
+		const float y_boundary	= c2_segment_value(pt_last, pt_first, m[pt_size - 1], m[0], h[pt_size - 1], fAniLength);
+
+		ptvEvaluatedCurvePts.push_back(Point(0, y_boundary));
+		ptvEvaluatedCurvePts.push_back(Point(fAniLength, y_boundary));
+
+	}
+
+	// no wrap
+	else {
+
+		for (int i = 0; i < pt_size - 1; i++) h[i] = std::max<double>(ptvCtrlPts[i + 1].x - ptvCtrlPts[i].x, h_min);
+
+		// start row
+		// clamped end has zero slope, so it joins the horizontal start segment smoothly
+		a[0] = 0;
+		if (bClamped) {
+			b[0] = 2 * h[0];
+			c[0] = h[0];
+			r[0] = 6 * ((ptvCtrlPts[1].y - ptvCtrlPts[0].y) / h[0]);
+		}
+		else {
+			b[0] = 1;
+			c[0] = 0;
+			r[0] = 0;
+		}
+
+		// middle row
+		for (int i = 1; i < pt_size - 1; i++) {
+			a[i] = h[i - 1];
+			b[i] = 2 * (h[i - 1] + h[i]);
+			c[i] = h[i];
+			r[i] = 6 * ((ptvCtrlPts[i + 1].y - ptvCtrlPts[i].y) / h[i] - (ptvCtrlPts[i].y - ptvCtrlPts[i - 1].y) / h[i - 1]);
+		}
+
+		// end row
+		c[pt_size - 1] = 0;
+		if (bClamped) {
+			a[pt_size - 1] = h[pt_size - 2];
+			b[pt_size - 1] = 2 * h[pt_size - 2];
+			r[pt_size - 1] = -6 * ((ptvCtrlPts[pt_size - 1].y - ptvCtrlPts[pt_size - 2].y) / h[pt_size - 2]);
+		}
+		else {
+			a[pt_size - 1] = 0;
+			b[pt_size - 1] = 1;
+			r[pt_size - 1] = 0;
+		}
+
+		solve_tridiagonal(pt_size, a, b, c, r, m, scratch.buffer.data());
+
+		// start point
+		draw_point(Point(0, ptvCtrlPts[0].y), ptvEvaluatedCurvePts);
+
+		// segment
+		for (int i = 0; i < pt_size - 1; i++) {
+			for (int k = 0; k < seg_count; k++) {
+				const float x = ptvCtrlPts[i].x + (float)(h[i] * k / seg_count);
+				ptvEvaluatedCurvePts.push_back(Point(x, c2_segment_value(ptvCtrlPts[i], ptvCtrlPts[i + 1], m[i], m[i + 1], h[i], x)));
+			}
+		}
+		draw_point(ptvCtrlPts[pt_size - 1], ptvEvaluatedCurvePts);
+
+		// end point
+		draw_point(Point(fAniLength, ptvCtrlPts[pt_size - 1].y), ptvEvaluatedCurvePts);
+	}
+}
+
+
+// Thomas algorithm, O(n)
+// a: sub-diagonal (a[0] unused), b: diagonal, c: super-diagonal (c[size - 1] unused)
+static void solve_tridiagonal(
+	const int size,
+	const double* a, const double* b, const double* c, const double* r,
+	double* x, double* buffer) {
+
+	buffer[0]	= c[0] / b[0];
+	x[0]		= r[0] / b[0];
+
+	for (int i = 1; i < size; i++) {
+		const double denom = b[i] - a[i] * buffer[i - 1];
+		buffer[i]	= c[i] / denom;
+		x[i]		= (r[i] - a[i] * x[i - 1]) / denom;
+	}
+
+	for (int i = size - 2; i >= 0; i--) x[i] -= buffer[i] * x[i + 1];
+}
+
+
+// Sherman-Morrison on top of the Thomas algorithm, O(n)
+// corner terms are a[0] (row 0, column size - 1) and c[size - 1] (row size - 1, column 0)
+// b is modified in place
+static void solve_cyclic_tridiagonal(
+	const int size,
+	const double* a, double* b, const double* c, const double* r,
+	double* x, double* z, double* buffer) {
+
+	const double alpha	= c[size - 1];
+	const double beta	= a[0];
+	const double gamma	= -b[0];
+
+	b[0]		-= gamma;
+	b[size - 1]	-= alpha * beta / gamma;
+
+	solve_tridiagonal(size, a, b, c, r, x, buffer);
+
+	// correction vector
+	for (int i = 0; i < size; i++) z[i] = 0;
+	z[0]		= gamma;
+	z[size - 1]	= alpha;
+	solve_tridiagonal(size, a, b, c, z, z, buffer);
+
+	const double factor = (x[0] + beta * x[size - 1] / gamma) / (1 + z[0] + beta * z[size - 1] / gamma);
+	for (int i = 0; i < size; i++) x[i] -= factor * z[i];
+}
+
+
+static float c2_segment_value(
+	const Point& pt_1, const Point& pt_2, const double m_1, const double m_2, const double h,
+	const float x) {
+
+	const double t_1 = pt_2.x - x;
+	const double t_2 = x - pt_1.x;
+
+	return (float)(
+		(m_1 * t_1 * t_1 * t_1 + m_2 * t_2 * t_2 * t_2) / (6 * h) +
+		(pt_1.y / h - m_1 * h / 6) * t_1 +
+		(pt_2.y / h - m_2 * h / 6) * t_2);
+}
\ No newline at end of file
@@ -48,4 +48,22 @@ public:
 };
 
 
+// C2 interpolating cubic spline y(x) through the control points
+// natural: zero second derivative at both ends
+// clamped: zero slope at both ends, matching the horizontal extension to 0 and fAniLength
+// wrap:	periodic spline, period fAniLength
+class C2InterpolatingCurveEvaluator : public CurveEvaluator {
+public:
+	C2InterpolatingCurveEvaluator(bool bClamped = true);
+
+	void evaluateCurve(const std::vector<Point>& ptvCtrlPts,
+		std::vector<Point>& ptvEvaluatedCurvePts,
+		const float& fAniLength,
+		const bool& bWrap) const;
+
+protected:
+	bool m_bClamped;
+};
+
+
 #endif
\ No newline at end of file
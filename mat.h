@@ -380,10 +380,22 @@ inline void swap(Mat3<T>& a, Mat3<T>& b) {
 //	swap( a.v[2], b.v[2] );
 }
 
+// angle in radians, about the axis (x, y, z)
 template <class T>
 inline Mat4<T> Mat4<T>::createRotation( T angle, float x, float y, float z ) {
 	Mat4<T> rot;
 
+	T len = sqrt( (T)x*x + (T)y*y + (T)z*z );
+	if( len == 0 )
+		return rot;
+
+	T ax = x / len, ay = y / len, az = z / len;
+	T c = cos( angle ), s = sin( angle ), t = 1 - c;
+
+	rot.n[ 0] = ax*ax*t + c;	rot.n[ 1] = ax*ay*t - az*s;	rot.n[ 2] = ax*az*t + ay*s;
+	rot.n[ 4] = ay*ax*t + az*s;	rot.n[ 5] = ay*ay*t + c;	rot.n[ 6] = ay*az*t - ax*s;
+	rot.n[ 8] = az*ax*t - ay*s;	rot.n[ 9] = az*ay*t + ax*s;	rot.n[10] = az*az*t + c;
+
 	return rot;
 }
 
@@ -391,6 +403,10 @@ template <class T>
 inline Mat4<T> Mat4<T>::createTranslation( T x, T y, T z ) {
 	Mat4<T> trans;
 
+	trans.n[ 3] = x;
+	trans.n[ 7] = y;
+	trans.n[11] = z;
+
 	return trans;
 }
 
@@ -398,6 +414,10 @@ template <class T>
 inline Mat4<T> Mat4<T>::createScale( T sx, T sy, T sz ) {
 	Mat4<T> scale;
 
+	scale.n[ 0] = sx;
+	scale.n[ 5] = sy;
+	scale.n[10] = sz;
+
 	return scale;
 }
 
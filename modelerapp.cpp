@@ -5,6 +5,11 @@
 #include "modelerview.h"
 #include "modelerui.h"
 #include "camera.h"
+#include "modeleroffscreen.h"
+#include "modelerraster.h"
+#include "modelerdraw.h"
+#include "ModelRayFile.h"
+#include "parallel.h"
 
 #include <FL/Fl_Value_Slider.H>
 #include <FL/Fl_Box.H>
@@ -12,6 +17,30 @@
 #include <cstring>
 #include <cstdio>
 #include <cstdlib>
+#include <string>
+#include <vector>
+#include <atomic>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+
+// A headless worker process started by RunFarm()
+struct WorkerProcess
+{
+#ifdef _WIN32
+	HANDLE hProcess;
+#else
+	pid_t pid;
+#endif
+};
+
+static bool spawnWorker(const std::vector<std::string>& args, WorkerProcess& process);
+static bool waitWorker(WorkerProcess& process);
 
 // CLASS ModelerControl METHODS
 
@@ -122,11 +151,384 @@ int ModelerApplication::Run()
 	return Fl::run();
 }
 
+int ModelerApplication::Run(int argc, char* argv[])
+{
+	if (argc < 2)
+		return Run();
+
+	const bool bRay = (strcmp(argv[1], "--export-ray") == 0);
+	if (!bRay && strcmp(argv[1], "--headless") != 0)
+		return Run();
+
+	std::vector<const char*> args;
+	int firstFrame = 0;
+	int lastFrame  = -1;
+	int workers    = 1;
+	bool bRaster   = false;
+	for (int i = 2; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--frames") == 0 && i + 2 < argc)
+		{
+			firstFrame = atoi(argv[++i]);
+			lastFrame  = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+			workers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--raster") == 0)
+			bRaster = true;
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			parallelSetThreadLimit(atoi(argv[++i]));
+		else
+			args.push_back(argv[i]);
+	}
+
+	if (bRay)
+	{
+		if (args.size() < 2)
+		{
+			fprintf(stderr, "usage: %s --export-ray <script.ani> <output prefix> "
+				"[width height [fps]] [--frames first last]\n", argv[0]);
+			return -1;
+		}
+
+		int width  = (args.size() > 3) ? atoi(args[2]) : 640;
+		int height = (args.size() > 3) ? atoi(args[3]) : 480;
+		int fps    = (args.size() > 4) ? atoi(args[4]) : m_ui->fps();
+		return RunRayExport(args[0], args[1], width, height, fps, firstFrame, lastFrame);
+	}
+
+	if (args.size() < 2)
+	{
+		fprintf(stderr, "usage: %s --headless <script.ani> <output prefix>[.bmp|.png|.avi] "
+			"[width height [fps [level]]] [--frames first last] [--workers count] [--raster] [--threads count]\n", argv[0]);
+		return -1;
+	}
+
+	int width  = (args.size() > 3) ? atoi(args[2]) : 640;
+	int height = (args.size() > 3) ? atoi(args[3]) : 480;
+	int fps    = (args.size() > 4) ? atoi(args[4]) : m_ui->fps();
+
+	// the extension of the prefix picks the format, like Save Movie
+	std::string output = args[1];
+	capture_format_t format = CAPTURE_BMP;
+	const size_t dot = output.rfind('.');
+	if (dot != std::string::npos && dot + 4 == output.length())
+	{
+		if (!stricmp(output.c_str() + dot, ".png"))
+		{
+			format = CAPTURE_PNG;
+			output.erase(dot);
+		}
+		else if (!stricmp(output.c_str() + dot, ".avi"))
+		{
+			format = CAPTURE_AVI;
+			output.erase(dot);
+		}
+		else if (!stricmp(output.c_str() + dot, ".bmp"))
+			output.erase(dot);
+	}
+
+	// PNG compression level or AVI JPEG quality
+	int level = (args.size() > 5) ? atoi(args[5]) : ((format == CAPTURE_AVI) ? 90 : 6);
+
+	if (workers > 1)
+		return RunFarm(argv[0], workers, args[0], output.c_str(), width, height, fps, format, level, bRaster);
+
+	return RunHeadless(args[0], output.c_str(), width, height, fps, format, level, firstFrame, lastFrame, bRaster);
+}
+
+int ModelerApplication::RunHeadless(const char* szScript, const char* szOutput,
+                                    int width, int height, int fps,
+                                    capture_format_t format, int level,
+                                    int firstFrame, int lastFrame, bool bRaster)
+{
+	if (m_numControls == -1)
+	{
+		fprintf(stderr, "ERROR: ModelerApplication must be initialized before RunHeadless()!\n");
+		return -1;
+	}
+	if (width <= 0 || height <= 0 || fps <= 0)
+	{
+		fprintf(stderr, "ERROR: invalid frame size %dx%d or fps %d\n", width, height, fps);
+		return -1;
+	}
+
+	// The UI is built but never shown; its widgets still hold the curves,
+	// the time and the camera, they are just never put on screen
+	// without an OpenGL context the frames are still drawn, in software
+	ModelerOffscreen offscreen;
+	ModelerRaster raster;
+	if (!bRaster && !offscreen.create(width, height))
+	{
+		fprintf(stderr, "WARNING: can't create an offscreen OpenGL context, drawing in software\n");
+		bRaster = true;
+	}
+	if (bRaster && !raster.create(width, height))
+	{
+		fprintf(stderr, "ERROR: can't create a %dx%d software frame\n", width, height);
+		return -1;
+	}
+
+	if (!m_ui->openAniScript(szScript))
+	{
+		fprintf(stderr, "ERROR: can't load the animation script %s\n", szScript);
+		return -1;
+	}
+
+	ModelerView* view = m_ui->m_pwndModelerView;
+	view->resize(0, 0, width, height);
+	m_ui->fps(fps);
+	m_ui->simulate(true);
+
+	const float startTime  = m_ui->playStartTime();
+	const float endTime    = m_ui->playEndTime();
+	const int   frameCount = int((endTime - startTime) * fps) + 1;
+
+	if (firstFrame < 0)
+		firstFrame = 0;
+	if (lastFrame < 0 || lastFrame >= frameCount)
+		lastFrame = frameCount - 1;
+	if (firstFrame > lastFrame)
+		return 0;
+
+	// particles carry state from frame to frame, so the frames before this
+	// range are simulated, not drawn, to match a render from the start;
+	// in the order of a drawn frame: ModelerView::draw emits from the
+	// matrices of the frame before, then the model evaluates this one
+	if (ps != NULL)
+	{
+		for (int frame = 0; frame < firstFrame; ++frame)
+		{
+			const float t = startTime + float(frame) / float(fps);
+			m_ui->currTime(t);
+			ps->computeForcesAndUpdateParticles(t);
+			if (callback_evaluate != nullptr)
+				callback_evaluate();
+		}
+	}
+
+	// frames are written by the capture threads while the next one is drawn
+	ModelerCapture capture;
+	capture.begin(szOutput, format, level, fps, lastFrame - firstFrame + 1, firstFrame);
+
+	ModelerDrawState* mds = ModelerDrawState::Instance();
+	if (bRaster)
+		mds->m_raster = &raster;
+
+	for (int frame = firstFrame; frame <= lastFrame; ++frame)
+	{
+		// setting the time evaluates the curves and runs the value-changed callback
+		m_ui->currTime(startTime + float(frame) / float(fps));
+
+		view->draw();
+		if (bRaster)
+		{
+			raster.end();
+			capture.capture(width, height, raster.pixels());
+		}
+		else
+			capture.capture(width, height);
+	}
+
+	mds->m_raster = NULL;
+	capture.end();
+	if (capture.failures() > 0)
+		return -1;
+	return 0;
+}
+
+int ModelerApplication::RunRayExport(const char* szScript, const char* szOutput,
+                                     int width, int height, int fps,
+                                     int firstFrame, int lastFrame)
+{
+	if (m_numControls == -1)
+	{
+		fprintf(stderr, "ERROR: ModelerApplication must be initialized before RunRayExport()!\n");
+		return -1;
+	}
+	if (callback_ray == nullptr)
+	{
+		fprintf(stderr, "ERROR: the model has no .ray export callback\n");
+		return -1;
+	}
+	if (width <= 0 || height <= 0 || fps <= 0)
+	{
+		fprintf(stderr, "ERROR: invalid frame size %dx%d or fps %d\n", width, height, fps);
+		return -1;
+	}
+
+	if (!m_ui->openAniScript(szScript))
+	{
+		fprintf(stderr, "ERROR: can't load the animation script %s\n", szScript);
+		return -1;
+	}
+
+	// the view is never drawn, it only supplies the camera, lights and aspect ratio
+	ModelerView* view = m_ui->m_pwndModelerView;
+	view->resize(0, 0, width, height);
+	m_ui->fps(fps);
+
+	const float startTime  = m_ui->playStartTime();
+	const float endTime    = m_ui->playEndTime();
+	const int   frameCount = int((endTime - startTime) * fps) + 1;
+
+	if (firstFrame < 0)
+		firstFrame = 0;
+	if (lastFrame < 0 || lastFrame >= frameCount)
+		lastFrame = frameCount - 1;
+	if (firstFrame > lastFrame)
+		return 0;
+
+	// the scene is shared, so a batch of frames is evaluated one after
+	// another into files that no longer depend on it, then written at once
+	const int batchSize = parallelThreadCount() * 2;
+	std::vector<ModelRayFile> files(batchSize);
+	std::atomic<int> failures(0);
+
+	for (int batchFirst = firstFrame; batchFirst <= lastFrame; batchFirst += batchSize)
+	{
+		const int count = (lastFrame - batchFirst + 1 < batchSize) ? lastFrame - batchFirst + 1 : batchSize;
+
+		for (int i = 0; i < count; ++i)
+		{
+			// setting the time evaluates the curves and runs the value-changed callback
+			m_ui->currTime(startTime + float(batchFirst + i) / float(fps));
+
+			files[i].clear();
+			view->setupRayFile(files[i]);
+			callback_ray(&files[i]);
+		}
+
+		parallelFor(count, [&](int i) {
+			char szName[64];
+			_snprintf(szName, 64, "%d.ray", batchFirst + i);
+			szName[63] = 0;
+
+			const std::string name = std::string(szOutput) + szName;
+			if (!files[i].save(name.c_str()))
+			{
+				fprintf(stderr, "ERROR: can't write %s\n", name.c_str());
+				++failures;
+			}
+		});
+	}
+
+	return (failures > 0) ? -1 : 0;
+}
+
+int ModelerApplication::RunFarm(const char* szProgram, int workers,
+                                const char* szScript, const char* szOutput,
+                                int width, int height, int fps,
+                                capture_format_t format, int level, bool bRaster)
+{
+	if (m_numControls == -1)
+	{
+		fprintf(stderr, "ERROR: ModelerApplication must be initialized before RunFarm()!\n");
+		return -1;
+	}
+	if (fps <= 0)
+	{
+		fprintf(stderr, "ERROR: invalid fps %d\n", fps);
+		return -1;
+	}
+
+	// a worker starting mid-range can only place the emitter when it can
+	// evaluate the model without drawing it
+	if (ps != NULL && callback_evaluate == nullptr)
+	{
+		fprintf(stderr, "ERROR: --workers needs setExtCallback_evaluate when there is a particle system\n");
+		return -1;
+	}
+
+	// only the play range is needed here, the workers do the rendering
+	if (!m_ui->openAniScript(szScript))
+	{
+		fprintf(stderr, "ERROR: can't load the animation script %s\n", szScript);
+		return -1;
+	}
+
+	const int frameCount = int((m_ui->playEndTime() - m_ui->playStartTime()) * fps) + 1;
+	if (workers > frameCount)
+		workers = frameCount;
+
+	// the workers share the machine, each gets its part of the threads for
+	// parallelFor, the capture writers and the raster tiles
+	const int threads = (parallelThreadCount() > workers) ? parallelThreadCount() / workers : 1;
+	char szThreads[32];
+	_snprintf(szThreads, 32, "%d", threads);
+	szThreads[31] = 0;
+
+	std::vector<WorkerProcess> processes;
+	int result = 0;
+
+	for (int worker = 0; worker < workers; ++worker)
+	{
+		// contiguous ranges, the first (frameCount % workers) one frame longer
+		const int firstFrame = worker * frameCount / workers;
+		const int lastFrame  = (worker + 1) * frameCount / workers - 1;
+
+		// an AVI can't be shared between processes, each range gets its own
+		// <prefix>_<first frame>.avi; image frames keep their global numbers
+		std::string output = szOutput;
+		char szNumber[32];
+		if (format == CAPTURE_AVI)
+		{
+			_snprintf(szNumber, 32, "_%d", firstFrame);
+			szNumber[31] = 0;
+			output += szNumber;
+		}
+		output += (format == CAPTURE_PNG) ? ".png" : (format == CAPTURE_AVI) ? ".avi" : ".bmp";
+
+		std::vector<std::string> args;
+		args.push_back(szProgram);
+		args.push_back("--headless");
+		args.push_back(szScript);
+		args.push_back(output);
+		_snprintf(szNumber, 32, "%d", width);	szNumber[31] = 0;	args.push_back(szNumber);
+		_snprintf(szNumber, 32, "%d", height);	szNumber[31] = 0;	args.push_back(szNumber);
+		_snprintf(szNumber, 32, "%d", fps);		szNumber[31] = 0;	args.push_back(szNumber);
+		_snprintf(szNumber, 32, "%d", level);	szNumber[31] = 0;	args.push_back(szNumber);
+		args.push_back("--frames");
+		_snprintf(szNumber, 32, "%d", firstFrame);	szNumber[31] = 0;	args.push_back(szNumber);
+		_snprintf(szNumber, 32, "%d", lastFrame);	szNumber[31] = 0;	args.push_back(szNumber);
+		if (bRaster)
+			args.push_back("--raster");
+		args.push_back("--threads");
+		args.push_back(szThreads);
+		args.insert(args.end(), m_workerArgs.begin(), m_workerArgs.end());
+
+		WorkerProcess process;
+		if (!spawnWorker(args, process))
+		{
+			fprintf(stderr, "ERROR: can't start worker %d for frames %d-%d\n", worker, firstFrame, lastFrame);
+			result = -1;
+			break;
+		}
+		processes.push_back(process);
+	}
+
+	for (size_t i = 0; i < processes.size(); ++i)
+	{
+		if (!waitWorker(processes[i]))
+		{
+			fprintf(stderr, "ERROR: worker %d failed\n", (int)i);
+			result = -1;
+		}
+	}
+
+	return result;
+}
+
 double ModelerApplication::GetControlValue(int controlNumber)
 {
     return m_ui->controlValue(controlNumber);
 }
 
+void ModelerApplication::GetControlValues(double* values, int count)
+{
+    m_ui->controlValues(values, count);
+}
+
 void ModelerApplication::SetControlValue(int controlNumber, double value)
 {
     m_ui->controlValue(controlNumber, value);
@@ -218,4 +620,109 @@ void ModelerApplication::RedrawLoop(void*)
 
 void ModelerApplication::setExtCallback_slider(void(*callback)()) {
 	callback_valChanged = callback;
-}
\ No newline at end of file
+}
+
+
+void ModelerApplication::setExtCallback_ray(void(*callback)(ModelRayFile*)) {
+	callback_ray = callback;
+}
+
+
+void ModelerApplication::setExtCallback_evaluate(void(*callback)()) {
+	callback_evaluate = callback;
+}
+
+
+void ModelerApplication::AddWorkerArgument(const char* arg)
+{
+	m_workerArgs.push_back(arg);
+}
+
+
+#ifdef _WIN32
+
+// Quote one argument the way the C runtime splits a command line back up
+static void appendArgument(std::string& commandLine, const std::string& arg)
+{
+	if (!commandLine.empty())
+		commandLine += ' ';
+
+	commandLine += '"';
+	size_t backslashes = 0;
+	for (size_t i = 0; i < arg.length(); ++i)
+	{
+		if (arg[i] == '\\')
+		{
+			++backslashes;
+			continue;
+		}
+		// backslashes before a quote are doubled, and the quote escaped
+		if (arg[i] == '"')
+			commandLine.append(backslashes * 2 + 1, '\\');
+		else
+			commandLine.append(backslashes, '\\');
+		backslashes = 0;
+		commandLine += arg[i];
+	}
+	commandLine.append(backslashes * 2, '\\');
+	commandLine += '"';
+}
+
+static bool spawnWorker(const std::vector<std::string>& args, WorkerProcess& process)
+{
+	// run this very executable, argv[0] may not carry a path
+	char szModule[MAX_PATH];
+	const DWORD length = GetModuleFileNameA(NULL, szModule, MAX_PATH);
+	const std::string program = (length > 0 && length < MAX_PATH) ? std::string(szModule) : args[0];
+
+	std::string commandLine;
+	appendArgument(commandLine, program);
+	for (size_t i = 1; i < args.size(); ++i)
+		appendArgument(commandLine, args[i]);
+
+	STARTUPINFOA startup;
+	ZeroMemory(&startup, sizeof(startup));
+	startup.cb = sizeof(startup);
+	PROCESS_INFORMATION info;
+	ZeroMemory(&info, sizeof(info));
+
+	std::vector<char> buffer(commandLine.begin(), commandLine.end());
+	buffer.push_back(0);
+	if (!CreateProcessA(program.c_str(), &buffer[0], NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info))
+		return false;
+
+	CloseHandle(info.hThread);
+	process.hProcess = info.hProcess;
+	return true;
+}
+
+static bool waitWorker(WorkerProcess& process)
+{
+	DWORD exitCode = 1;
+	WaitForSingleObject(process.hProcess, INFINITE);
+	GetExitCodeProcess(process.hProcess, &exitCode);
+	CloseHandle(process.hProcess);
+	return exitCode == 0;
+}
+
+#else
+
+static bool spawnWorker(const std::vector<std::string>& args, WorkerProcess& process)
+{
+	std::vector<char*> argv;
+	for (size_t i = 0; i < args.size(); ++i)
+		argv.push_back(const_cast<char*>(args[i].c_str()));
+	argv.push_back(NULL);
+
+	return posix_spawnp(&process.pid, argv[0], NULL, NULL, &argv[0], environ) == 0;
+}
+
+static bool waitWorker(WorkerProcess& process)
+{
+	int status = 0;
+	if (waitpid(process.pid, &status, 0) != process.pid)
+		return false;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+#endif
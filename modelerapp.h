@@ -6,6 +6,10 @@
 #define MODELERAPP_H
 
 #include "modelerview.h"
+#include "modelercapture.h"
+
+#include <string>
+#include <vector>
 
 struct ModelerControl
 {
@@ -29,6 +33,7 @@ class Fl_Box;
 class Fl_Slider;
 class Fl_Value_Slider;
 class ParticleSystem;
+class ModelRayFile;
 
 // The ModelerApplication is implemented as a "singleton" design pattern,
 // the purpose of which is to only allow one instance of it.
@@ -48,10 +53,58 @@ public:
     // Starts the application, returns when application is closed
 	int  Run();
 
+	// Same as Run(), unless the arguments are
+	//   --headless <script.ani> <output prefix>[.bmp|.png|.avi] [width height [fps [level]]]
+	//              [--frames first last] [--workers count] [--raster] [--threads count]
+	// where level is the PNG compression level or the AVI JPEG quality,
+	// in which case the frames are rendered without opening a window
+	// (--raster draws them with ModelerRaster instead of OpenGL, --threads caps
+	// the threads of the process, see parallelSetThreadLimit), or
+	//   --export-ray <script.ani> <output prefix> [width height [fps]]
+	//                [--frames first last]
+	// in which case the frames are exported as .ray scenes (see RunRayExport)
+	int  Run(int argc, char* argv[]);
+
+	// Render frames [firstFrame, lastFrame] of the script's play range
+	// offscreen (lastFrame < 0 runs to the end) and write them as
+	// <output prefix><frame>.bmp or .png, or into <output prefix>.avi,
+	// as fast as the frames can be drawn; returns 0 on success.
+	// With bRaster, or when no offscreen context can be created, the
+	// frames are drawn by the software renderer (see modelerraster.h)
+	int  RunHeadless(const char* szScript, const char* szOutput,
+	                 int width, int height, int fps,
+	                 capture_format_t format = CAPTURE_BMP, int level = 6,
+	                 int firstFrame = 0, int lastFrame = -1, bool bRaster = false);
+
+	// Split the frames of a headless render into contiguous ranges and
+	// render each one in its own worker process running szProgram;
+	// frames keep the numbers a single process would give them, and each
+	// worker is capped to its share of the hardware threads
+	int  RunFarm(const char* szProgram, int workers,
+	             const char* szScript, const char* szOutput,
+	             int width, int height, int fps,
+	             capture_format_t format, int level, bool bRaster = false);
+
+	// Append an argument the model's main() took out of argv before Run(),
+	// so the worker processes of RunFarm() see the same model
+	void AddWorkerArgument(const char* arg);
+
+	// Export frames [firstFrame, lastFrame] of the script's play range as
+	// <output prefix><frame>.ray, from the scene given to the ray callback;
+	// no OpenGL context is needed. Frames are evaluated one after another,
+	// a batch at a time, and each batch is formatted and written in
+	// parallel; width and height only set the aspect ratio
+	int  RunRayExport(const char* szScript, const char* szOutput,
+	                  int width, int height, int fps,
+	                  int firstFrame = 0, int lastFrame = -1);
+
     // Get and set slider values.
     double GetControlValue(int controlNumber);
     void   SetControlValue(int controlNumber, double value);
 
+	// Get the first count control values at once
+	void   GetControlValues(double* values, int count);
+
 	// Get and set particle system
 	ParticleSystem *GetParticleSystem();
 	void SetParticleSystem(ParticleSystem *s);
@@ -67,6 +120,11 @@ public:
 
 	// ext callback
 	void setExtCallback_slider(void(*callback)());
+	void setExtCallback_ray(void(*callback)(ModelRayFile*));
+
+	// evaluate the model for the current time without drawing it; run for the
+	// frames a headless render skips, so the particle emitter follows the model
+	void setExtCallback_evaluate(void(*callback)());
 
 private:
 	// Private for singleton
@@ -82,6 +140,11 @@ private:
 
 	// ext callback
 	void (*callback_valChanged)() = nullptr;
+	void (*callback_ray)(ModelRayFile*) = nullptr;
+	void (*callback_evaluate)() = nullptr;
+
+	// model arguments passed on to the workers of RunFarm()
+	std::vector<std::string> m_workerArgs;
 
     static void ValueChangedCallback();
 	static void RedrawLoop(void*);
@@ -0,0 +1,354 @@
+#include "modelercapture.h"
+#include "bitmap.h"
+#include "pngfile.h"
+#include "jpegfile.h"
+#include "parallel.h"
+
+#include <FL/gl.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+// GL_ARB_pixel_buffer_object / GL_ARB_vertex_buffer_object, not in the GL 1.1 headers
+#define CAPTURE_PIXEL_PACK_BUFFER	0x88EB
+#define CAPTURE_STREAM_READ			0x88E1
+#define CAPTURE_READ_ONLY			0x88B8
+
+typedef ptrdiff_t GLsizeiptrCapture;
+typedef void (APIENTRY *PFNGENBUFFERS)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY *PFNDELETEBUFFERS)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRY *PFNBINDBUFFER)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *PFNBUFFERDATA)(GLenum target, GLsizeiptrCapture size, const void* data, GLenum usage);
+typedef void* (APIENTRY *PFNMAPBUFFER)(GLenum target, GLenum access);
+typedef GLboolean (APIENTRY *PFNUNMAPBUFFER)(GLenum target);
+
+static PFNGENBUFFERS	glGenBuffersCapture		= NULL;
+static PFNDELETEBUFFERS	glDeleteBuffersCapture	= NULL;
+static PFNBINDBUFFER	glBindBufferCapture		= NULL;
+static PFNBUFFERDATA	glBufferDataCapture		= NULL;
+static PFNMAPBUFFER		glMapBufferCapture		= NULL;
+static PFNUNMAPBUFFER	glUnmapBufferCapture	= NULL;
+
+// BMP writing is bound by the disk, so a couple of writers keep it busy;
+// PNG and JPEG encoding is bound by the CPU and gets a writer per hardware thread.
+// Each writer has two frames in flight, plus two for the readback.
+static const int kBMPWriterCount	= 2;
+
+ModelerCapture::ModelerCapture() :
+m_bActive(false),
+m_format(CAPTURE_BMP),
+m_iLevel(6),
+m_iFps(30),
+m_iFrameHint(0),
+m_iFrameNum(0),
+m_iFailures(0),
+m_bReadbackInit(false),
+m_bPixelBuffer(false),
+m_iSlot(0),
+m_bStop(false),
+m_iAviNext(0)
+{
+	for (int i = 0; i < 2; ++i) {
+		m_uiPixelBuffer[i] = 0;
+		m_iPixelBufferSize[i] = 0;
+		m_bPending[i] = false;
+		m_iPendingIndex[i] = 0;
+		m_iPendingWidth[i] = 0;
+		m_iPendingHeight[i] = 0;
+	}
+}
+
+ModelerCapture::~ModelerCapture()
+{
+	// without a current context the pixel buffers can't be read back,
+	// so only the frames already queued are written
+	if (m_bActive) {
+		m_bPending[0] = m_bPending[1] = false;
+		m_bPixelBuffer = false;
+		end();
+	}
+}
+
+void ModelerCapture::begin(const char* szPrefix, capture_format_t format, int iLevel,
+                           int iFps, int iFrameHint, int iFirstFrame)
+{
+	if (m_bActive)
+		end();
+
+	m_strPrefix = szPrefix;
+	m_format = format;
+	m_iLevel = iLevel;
+	m_iFps = (iFps > 0) ? iFps : 30;
+	m_iFrameHint = iFrameHint;
+	m_iAviNext = iFirstFrame;
+	m_iFrameNum = iFirstFrame;
+	m_iFailures = 0;
+	m_iSlot = 0;
+	m_bStop = false;
+
+	const int iWriterCount = (m_format == CAPTURE_BMP) ? kBMPWriterCount : parallelThreadCount();
+	const int iFrameCount = 2 * iWriterCount + 2;
+
+	m_vFrames.resize(iFrameCount);
+	for (int i = 0; i < iFrameCount; ++i) {
+		m_vFrames[i] = new Frame;
+		m_dqFree.push_back(m_vFrames[i]);
+	}
+	for (int i = 0; i < iWriterCount; ++i)
+		m_vWriters.push_back(std::thread(&ModelerCapture::writerLoop, this));
+
+	m_bActive = true;
+}
+
+void ModelerCapture::capture(int width, int height)
+{
+	if (!m_bActive || width <= 0 || height <= 0) return;
+
+	if (!m_bReadbackInit)
+		initReadback();
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glPixelStorei(GL_PACK_ROW_LENGTH, width);
+
+	if (!m_bPixelBuffer) {
+		Frame* pFrame = acquireFrame();
+		pFrame->iIndex = m_iFrameNum++;
+		pFrame->bValid = true;
+		pFrame->iWidth = width;
+		pFrame->iHeight = height;
+		pFrame->vPixels.resize(3 * width * height);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pFrame->vPixels[0]);
+		queueFrame(pFrame);
+		return;
+	}
+
+	// start the transfer of this frame without waiting for it
+	const int iSlot = m_iSlot;
+	const int iSize = 3 * width * height;
+	glBindBufferCapture(CAPTURE_PIXEL_PACK_BUFFER, m_uiPixelBuffer[iSlot]);
+	if (m_iPixelBufferSize[iSlot] != iSize) {
+		glBufferDataCapture(CAPTURE_PIXEL_PACK_BUFFER, iSize, NULL, CAPTURE_STREAM_READ);
+		m_iPixelBufferSize[iSlot] = iSize;
+	}
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+	m_bPending[iSlot] = true;
+	m_iPendingIndex[iSlot] = m_iFrameNum++;
+	m_iPendingWidth[iSlot] = width;
+	m_iPendingHeight[iSlot] = height;
+
+	// the previous frame had a whole frame's time to arrive
+	m_iSlot = 1 - iSlot;
+	collect(m_iSlot);
+
+	glBindBufferCapture(CAPTURE_PIXEL_PACK_BUFFER, 0);
+}
+
+void ModelerCapture::capture(int width, int height, const unsigned char* pixels)
+{
+	if (!m_bActive || width <= 0 || height <= 0 || pixels == NULL) return;
+
+	Frame* pFrame = acquireFrame();
+	pFrame->iIndex = m_iFrameNum++;
+	pFrame->bValid = true;
+	pFrame->iWidth = width;
+	pFrame->iHeight = height;
+	pFrame->vPixels.assign(pixels, pixels + 3 * width * height);
+	queueFrame(pFrame);
+}
+
+void ModelerCapture::end()
+{
+	if (!m_bActive) return;
+
+	// the older pending slot first, so frames reach the queue in order
+	if (m_bPixelBuffer) {
+		collect(m_iSlot);
+		collect(1 - m_iSlot);
+		glBindBufferCapture(CAPTURE_PIXEL_PACK_BUFFER, 0);
+	}
+	freeReadback();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+	m_cvQueue.notify_all();
+	for (size_t i = 0; i < m_vWriters.size(); ++i)
+		m_vWriters[i].join();
+	m_vWriters.clear();
+
+	if (m_avi.isOpen() && !m_avi.close())
+		++m_iFailures;
+
+	for (size_t i = 0; i < m_vFrames.size(); ++i)
+		delete m_vFrames[i];
+	m_vFrames.clear();
+	m_dqFree.clear();
+	m_dqQueue.clear();
+
+	if (m_iFailures > 0)
+		fprintf(stderr, "ERROR: %d movie frames could not be written\n", m_iFailures);
+
+	m_bActive = false;
+}
+
+void ModelerCapture::initReadback()
+{
+	m_bReadbackInit = true;
+	m_bPixelBuffer = false;
+
+#ifdef _WIN32
+	const char* szExtensions = (const char*)glGetString(GL_EXTENSIONS);
+	if (szExtensions == NULL || strstr(szExtensions, "GL_ARB_pixel_buffer_object") == NULL)
+		return;
+
+	glGenBuffersCapture		= (PFNGENBUFFERS)wglGetProcAddress("glGenBuffersARB");
+	glDeleteBuffersCapture	= (PFNDELETEBUFFERS)wglGetProcAddress("glDeleteBuffersARB");
+	glBindBufferCapture		= (PFNBINDBUFFER)wglGetProcAddress("glBindBufferARB");
+	glBufferDataCapture		= (PFNBUFFERDATA)wglGetProcAddress("glBufferDataARB");
+	glMapBufferCapture		= (PFNMAPBUFFER)wglGetProcAddress("glMapBufferARB");
+	glUnmapBufferCapture	= (PFNUNMAPBUFFER)wglGetProcAddress("glUnmapBufferARB");
+
+	if (glGenBuffersCapture == NULL || glDeleteBuffersCapture == NULL ||
+		glBindBufferCapture == NULL || glBufferDataCapture == NULL ||
+		glMapBufferCapture == NULL || glUnmapBufferCapture == NULL)
+		return;
+
+	glGenBuffersCapture(2, m_uiPixelBuffer);
+	m_iPixelBufferSize[0] = m_iPixelBufferSize[1] = 0;
+	m_bPixelBuffer = true;
+#endif
+}
+
+void ModelerCapture::freeReadback()
+{
+	if (m_bPixelBuffer)
+		glDeleteBuffersCapture(2, m_uiPixelBuffer);
+
+	for (int i = 0; i < 2; ++i) {
+		m_uiPixelBuffer[i] = 0;
+		m_iPixelBufferSize[i] = 0;
+		m_bPending[i] = false;
+	}
+	m_bReadbackInit = false;
+	m_bPixelBuffer = false;
+}
+
+void ModelerCapture::collect(int iSlot)
+{
+	if (!m_bPending[iSlot]) return;
+	m_bPending[iSlot] = false;
+
+	Frame* pFrame = acquireFrame();
+	pFrame->iIndex = m_iPendingIndex[iSlot];
+	pFrame->iWidth = m_iPendingWidth[iSlot];
+	pFrame->iHeight = m_iPendingHeight[iSlot];
+	pFrame->vPixels.resize(3 * pFrame->iWidth * pFrame->iHeight);
+
+	// a frame that can't be mapped is still queued, so an AVI doesn't wait for it
+	glBindBufferCapture(CAPTURE_PIXEL_PACK_BUFFER, m_uiPixelBuffer[iSlot]);
+	const void* pvData = glMapBufferCapture(CAPTURE_PIXEL_PACK_BUFFER, CAPTURE_READ_ONLY);
+	pFrame->bValid = (pvData != NULL);
+	if (pFrame->bValid) {
+		memcpy(&pFrame->vPixels[0], pvData, pFrame->vPixels.size());
+		glUnmapBufferCapture(CAPTURE_PIXEL_PACK_BUFFER);
+	}
+	queueFrame(pFrame);
+}
+
+ModelerCapture::Frame* ModelerCapture::acquireFrame()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cvFree.wait(lock, [this] { return !m_dqFree.empty(); });
+
+	Frame* pFrame = m_dqFree.front();
+	m_dqFree.pop_front();
+	return pFrame;
+}
+
+void ModelerCapture::queueFrame(Frame* pFrame)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_dqQueue.push_back(pFrame);
+	}
+	m_cvQueue.notify_one();
+}
+
+void ModelerCapture::writerLoop()
+{
+	for (;;) {
+		Frame* pFrame;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cvQueue.wait(lock, [this] { return m_bStop || !m_dqQueue.empty(); });
+			if (m_dqQueue.empty())
+				return;
+			pFrame = m_dqQueue.front();
+			m_dqQueue.pop_front();
+		}
+
+		const bool bWritten = writeFrame(pFrame);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!bWritten)
+				++m_iFailures;
+			m_dqFree.push_back(pFrame);
+		}
+		m_cvFree.notify_one();
+	}
+}
+
+bool ModelerCapture::writeFrame(Frame* pFrame)
+{
+	switch (m_format) {
+	case CAPTURE_PNG:
+		return pFrame->bValid && writePNG(fileName(pFrame->iIndex).c_str(),
+			pFrame->iWidth, pFrame->iHeight, &pFrame->vPixels[0], m_iLevel);
+	case CAPTURE_AVI:
+		return appendFrame(pFrame);
+	default:
+		return pFrame->bValid && writeBMP(fileName(pFrame->iIndex).c_str(),
+			pFrame->iWidth, pFrame->iHeight, &pFrame->vPixels[0]);
+	}
+}
+
+bool ModelerCapture::appendFrame(Frame* pFrame)
+{
+	// encode outside the lock, that is the part worth running in parallel
+	const bool bEncoded = pFrame->bValid &&
+		encodeJPEG(pFrame->iWidth, pFrame->iHeight, &pFrame->vPixels[0], m_iLevel, pFrame->vEncoded);
+
+	std::unique_lock<std::mutex> lock(m_mutexAvi);
+	m_cvAvi.wait(lock, [this, pFrame] { return m_iAviNext == pFrame->iIndex; });
+
+	// the first frame written decides the size recorded in the header
+	bool bWritten = false;
+	if (bEncoded) {
+		if (!m_avi.isOpen())
+			m_avi.open(fileName(0).c_str(), pFrame->iWidth, pFrame->iHeight, m_iFps, m_iFrameHint);
+		bWritten = m_avi.writeFrame(&pFrame->vEncoded[0], (int)pFrame->vEncoded.size());
+	}
+
+	++m_iAviNext;
+	lock.unlock();
+	m_cvAvi.notify_all();
+	return bWritten;
+}
+
+std::string ModelerCapture::fileName(int iIndex) const
+{
+	if (m_format == CAPTURE_AVI)
+		return m_strPrefix + ".avi";
+
+	char szFrameNum[128];
+	_snprintf(szFrameNum, 128, "%d", iIndex);
+	szFrameNum[127] = 0;
+	return m_strPrefix + szFrameNum + ((m_format == CAPTURE_PNG) ? ".png" : ".bmp");
+}
@@ -0,0 +1,119 @@
+// modelercapture.h
+
+// Movie frame capture.  Each frame is read back from the current OpenGL
+// context and handed to background writer threads, so drawing the next
+// frame overlaps with writing the previous one to disk.  Where the driver
+// has pixel buffer objects the readback is double-buffered too: frame N
+// is copied out only after frame N+1 has been queued.  Frames are saved
+// as BMP, or as PNG encoded in parallel on one writer per hardware thread,
+// or as Motion-JPEG appended in order to a single AVI file.
+
+#ifndef MODELERCAPTURE_H
+#define MODELERCAPTURE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "aviwriter.h"
+
+typedef enum { CAPTURE_BMP, CAPTURE_PNG, CAPTURE_AVI } capture_format_t;
+
+class ModelerCapture
+{
+public:
+	ModelerCapture();
+	~ModelerCapture();
+
+	// Start writing frames as <prefix><frame>.bmp or .png, or into <prefix>.avi;
+	// iLevel is the PNG compression level, 0 (fastest) to 9 (smallest),
+	// or the JPEG quality of an AVI, 1 to 100; iFps is the AVI frame rate
+	// and iFrameHint the number of frames expected, to size its index;
+	// frame numbers start at iFirstFrame
+	void begin(const char* szPrefix, capture_format_t format = CAPTURE_BMP, int iLevel = 6,
+	           int iFps = 30, int iFrameHint = 0, int iFirstFrame = 0);
+
+	// Queue the read buffer of the current context as the next frame;
+	// blocks only while every frame buffer is waiting to be written
+	void capture(int width, int height);
+
+	// Queue pixels drawn without OpenGL (RGB, rows bottom-up and tightly
+	// packed, like glReadPixels) as the next frame; no context is needed
+	void capture(int width, int height, const unsigned char* pixels);
+
+	// Write out every queued frame and stop the writer threads;
+	// the context used by capture() must be current
+	void end();
+
+	bool active() const { return m_bActive; }
+
+	// Number of frames that could not be written since begin()
+	int failures() const { return m_iFailures; }
+
+private:
+	ModelerCapture(const ModelerCapture&);
+	ModelerCapture& operator=(const ModelerCapture&);
+
+	struct Frame
+	{
+		int iIndex;
+		bool bValid;
+		int iWidth;
+		int iHeight;
+		std::vector<unsigned char> vPixels;
+		std::vector<unsigned char> vEncoded;
+	};
+
+	void initReadback();
+	void freeReadback();
+	void collect(int iSlot);
+
+	Frame* acquireFrame();
+	void queueFrame(Frame* pFrame);
+	void writerLoop();
+	bool writeFrame(Frame* pFrame);
+	bool appendFrame(Frame* pFrame);
+
+	std::string fileName(int iIndex) const;
+
+	bool m_bActive;
+	std::string m_strPrefix;
+	capture_format_t m_format;
+	int m_iLevel;
+	int m_iFps;
+	int m_iFrameHint;
+	int m_iFrameNum;
+	int m_iFailures;
+
+	// double-buffered readback through pixel buffer objects
+	bool m_bReadbackInit;
+	bool m_bPixelBuffer;
+	unsigned int m_uiPixelBuffer[2];
+	int m_iPixelBufferSize[2];
+	bool m_bPending[2];
+	int m_iPendingIndex[2];
+	int m_iPendingWidth[2];
+	int m_iPendingHeight[2];
+	int m_iSlot;
+
+	// a fixed pool of frames bounds the queue
+	std::vector<Frame*> m_vFrames;
+	std::deque<Frame*> m_dqFree;
+	std::deque<Frame*> m_dqQueue;
+	std::mutex m_mutex;
+	std::condition_variable m_cvFree;
+	std::condition_variable m_cvQueue;
+	bool m_bStop;
+	std::vector<std::thread> m_vWriters;
+
+	// AVI frames are encoded in parallel but appended in index order
+	AviWriter m_avi;
+	std::mutex m_mutexAvi;
+	std::condition_variable m_cvAvi;
+	int m_iAviNext;
+};
+
+#endif
@@ -3,6 +3,8 @@
 #include <GL/glu.h>
 #include <cstdio>
 #include <math.h>
+#include "ModelMesh.h"
+#include "modelerraster.h"
 
 // ********************************************************
 // Support functions from previous version of modeler
@@ -43,6 +45,19 @@ void _dump_current_material( void )
         mds->m_diffuseColor[0], mds->m_diffuseColor[1], mds->m_diffuseColor[2]);
 }
 
+static const int kMaterialAmbient   = 1;
+static const int kMaterialDiffuse   = 2;
+static const int kMaterialSpecular  = 4;
+static const int kMaterialShininess = 8;
+
+// record a material change, sent by the next applyDrawState()
+static void _touch_material( int bit )
+{
+    ModelerDrawState *mds = ModelerDrawState::Instance();
+    mds->m_materialSet |= bit;
+    mds->m_materialDirty |= bit;
+}
+
 // ****************************************************************************
 
 // Initially assign singleton instance to NULL
@@ -61,6 +76,11 @@ ModelerDrawState::ModelerDrawState() : m_drawMode(NORMAL), m_quality(MEDIUM)
     m_shininess = 0.5;
     
     m_rayFile = NULL;
+    m_raster = NULL;
+
+    m_appliedDrawMode = -1;
+    m_materialSet = 0;
+    m_materialDirty = 0;
 }
 
 // CLASS ModelerDrawState METHODS
@@ -83,9 +103,7 @@ void setAmbientColor(float r, float g, float b)
     mds->m_ambientColor[1] = (GLfloat)g;
     mds->m_ambientColor[2] = (GLfloat)b;
     mds->m_ambientColor[3] = (GLfloat)1.0;
-    
-    if (mds->m_drawMode == NORMAL)
-        glMaterialfv( GL_FRONT_AND_BACK, GL_AMBIENT, mds->m_ambientColor);
+    _touch_material(kMaterialAmbient);
 }
 
 void setDiffuseColor(float r, float g, float b)
@@ -96,11 +114,7 @@ void setDiffuseColor(float r, float g, float b)
     mds->m_diffuseColor[1] = (GLfloat)g;
     mds->m_diffuseColor[2] = (GLfloat)b;
     mds->m_diffuseColor[3] = (GLfloat)1.0;
-    
-    if (mds->m_drawMode == NORMAL)
-        glMaterialfv( GL_FRONT_AND_BACK, GL_DIFFUSE, mds->m_diffuseColor);
-    else
-        glColor3f(r,g,b);
+    _touch_material(kMaterialDiffuse);
 }
 
 void setSpecularColor(float r, float g, float b)
@@ -111,9 +125,7 @@ void setSpecularColor(float r, float g, float b)
     mds->m_specularColor[1] = (GLfloat)g;
     mds->m_specularColor[2] = (GLfloat)b;
     mds->m_specularColor[3] = (GLfloat)1.0;
-    
-    if (mds->m_drawMode == NORMAL)
-        glMaterialfv( GL_FRONT_AND_BACK, GL_SPECULAR, mds->m_specularColor);
+    _touch_material(kMaterialSpecular);
 }
 
 void setShininess(float s)
@@ -121,9 +133,7 @@ void setShininess(float s)
     ModelerDrawState *mds = ModelerDrawState::Instance();
     
     mds->m_shininess = (GLfloat)s;
-    
-    if (mds->m_drawMode == NORMAL)
-        glMaterialf( GL_FRONT, GL_SHININESS, mds->m_shininess);
+    _touch_material(kMaterialShininess);
 }
 
 void setDrawMode(DrawModeSetting_t drawMode)
@@ -136,6 +146,87 @@ void setQuality(QualitySetting_t quality)
     ModelerDrawState::Instance()->m_quality = quality;
 }
 
+int getQualityDivisions()
+{
+    return getQualityDivisions(ModelerDrawState::Instance()->m_quality);
+}
+
+int getQualityDivisions(QualitySetting_t quality)
+{
+    switch(quality)
+    {
+    case HIGH: 
+        return 32;
+    case MEDIUM: 
+        return 20;
+    case LOW:
+        return 12;
+    case POOR:
+    default:
+        return 8;
+    }
+}
+
+void applyDrawState()
+{
+    ModelerDrawState *mds = ModelerDrawState::Instance();
+
+    if (mds->m_raster)
+        return;
+
+    if (mds->m_appliedDrawMode != mds->m_drawMode)
+    {
+        switch (mds->m_drawMode)
+        {
+        case NORMAL:
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            glShadeModel(GL_SMOOTH);
+            break;
+        case FLATSHADE:
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+            glShadeModel(GL_FLAT);
+            break;
+        case WIREFRAME:
+            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            glShadeModel(GL_FLAT);
+        default:
+            break;
+        }
+
+        /* materials are sent differently in NORMAL mode. */
+        mds->m_appliedDrawMode = mds->m_drawMode;
+        mds->m_materialDirty = mds->m_materialSet;
+    }
+
+    const int dirty = mds->m_materialDirty;
+    if (dirty == 0)
+        return;
+
+    if (mds->m_drawMode == NORMAL)
+    {
+        if (dirty & kMaterialAmbient)
+            glMaterialfv( GL_FRONT_AND_BACK, GL_AMBIENT, mds->m_ambientColor);
+        if (dirty & kMaterialDiffuse)
+            glMaterialfv( GL_FRONT_AND_BACK, GL_DIFFUSE, mds->m_diffuseColor);
+        if (dirty & kMaterialSpecular)
+            glMaterialfv( GL_FRONT_AND_BACK, GL_SPECULAR, mds->m_specularColor);
+        if (dirty & kMaterialShininess)
+            glMaterialf( GL_FRONT, GL_SHININESS, mds->m_shininess);
+    }
+    else if (dirty & kMaterialDiffuse)
+        glColor3f(mds->m_diffuseColor[0], mds->m_diffuseColor[1], mds->m_diffuseColor[2]);
+
+    mds->m_materialDirty = 0;
+}
+
+void invalidateDrawState()
+{
+    ModelerDrawState *mds = ModelerDrawState::Instance();
+
+    mds->m_appliedDrawMode = -1;
+    mds->m_materialDirty = mds->m_materialSet;
+}
+
 bool openRayFile(const char rayFileName[])
 {
     ModelerDrawState *mds = ModelerDrawState::Instance();
@@ -164,24 +255,7 @@ bool openRayFile(const char rayFileName[])
 
 void _setupOpenGl()
 {
-    ModelerDrawState *mds = ModelerDrawState::Instance();
-	switch (mds->m_drawMode)
-	{
-	case NORMAL:
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-		glShadeModel(GL_SMOOTH);
-		break;
-	case FLATSHADE:
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-		glShadeModel(GL_FLAT);
-		break;
-	case WIREFRAME:
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		glShadeModel(GL_FLAT);
-	default:
-		break;
-	}
-
+    applyDrawState();
 }
 
 void closeRayFile()
@@ -195,6 +269,40 @@ void closeRayFile()
 }
 
 
+/* cylinder of the given size from a cached mesh of unit height and radius,
+   keyed by the divisions and the ratio of the radii only, so the cache
+   doesn't grow with every size drawn. */
+static void _draw_cylinder_mesh( int divisions, double h, double r1, double r2 )
+{
+    ModelerDrawState *mds = ModelerDrawState::Instance();
+
+    /* a zero height or radius keeps its own mesh, it can't be scaled to. */
+    const double r  = (r1 > r2) ? r1 : r2;
+    const double sr = (r > 0) ? r : 1;
+    const double sh = (h != 0) ? h : 1;
+
+    ModelMeshKey key(ModelMeshKey::MESH_CYLINDER);
+    key.value_i[0] = divisions;
+    key.value_i[1] = 1;
+    key.value_d[0] = h / sh;
+    key.value_d[1] = r1 / sr;
+    key.value_d[2] = r2 / sr;
+
+    const ModelMesh* mesh = ModelMeshCache::Instance()->get(key);
+
+    if (mds->m_raster)
+    {
+        mds->m_raster->drawMesh(*mesh, Mat4d::createScale(sr, sr, sh));
+        return;
+    }
+
+    glPushMatrix();
+    glScaled( sr, sr, sh );
+    mesh->draw();
+    glPopMatrix();
+}
+
+
 void drawSphere(double r)
 {
     ModelerDrawState *mds = ModelerDrawState::Instance();
@@ -210,26 +318,22 @@ void drawSphere(double r)
     }
     else
     {
-        int divisions; 
-        GLUquadricObj* gluq;
+        int divisions = getQualityDivisions();
         
-        switch(mds->m_quality)
+        /* unit sphere tessellated once per quality, scaled to r. */
+        ModelMeshKey key(ModelMeshKey::MESH_SPHERE);
+        key.value_i[0] = divisions;
+
+        if (mds->m_raster)
         {
-        case HIGH: 
-            divisions = 32; break;
-        case MEDIUM: 
-            divisions = 20; break;
-        case LOW:
-            divisions = 12; break;
-        case POOR:
-            divisions = 8; break;
+            mds->m_raster->drawMesh(*ModelMeshCache::Instance()->get(key), Mat4d::createScale(r, r, r));
+            return;
         }
-        
-        gluq = gluNewQuadric();
-        gluQuadricDrawStyle( gluq, GLU_FILL );
-        gluQuadricTexture( gluq, GL_TRUE );
-        gluSphere(gluq, r, divisions, divisions);
-        gluDeleteQuadric( gluq );
+
+        glPushMatrix();
+        glScaled( r, r, r );
+        ModelMeshCache::Instance()->get(key)->draw();
+        glPopMatrix();
     }
 }
 
@@ -248,6 +352,11 @@ void drawBox( double x, double y, double z )
         _dump_current_material();
         fprintf(mds->m_rayFile,  "})))\n" );
     }
+    else if (mds->m_raster)
+    {
+        mds->m_raster->drawMesh(*ModelMeshCache::Instance()->get(ModelMeshKey(ModelMeshKey::MESH_BOX)),
+            Mat4d::createScale(x, y, z));
+    }
     else
     {
         /* remember which matrix mode OpenGL was in. */
@@ -259,33 +368,7 @@ void drawBox( double x, double y, double z )
         glPushMatrix();
         glScaled( x, y, z );
         
-        glBegin( GL_QUADS );
-        
-        glNormal3d( 0.0, 0.0, -1.0 );
-        glVertex3d( 0.0, 0.0, 0.0 ); glVertex3d( 0.0, 1.0, 0.0 );
-        glVertex3d( 1.0, 1.0, 0.0 ); glVertex3d( 1.0, 0.0, 0.0 );
-        
-        glNormal3d( 0.0, -1.0, 0.0 );
-        glVertex3d( 0.0, 0.0, 0.0 ); glVertex3d( 1.0, 0.0, 0.0 );
-        glVertex3d( 1.0, 0.0, 1.0 ); glVertex3d( 0.0, 0.0, 1.0 );
-        
-        glNormal3d( -1.0, 0.0, 0.0 );
-        glVertex3d( 0.0, 0.0, 0.0 ); glVertex3d( 0.0, 0.0, 1.0 );
-        glVertex3d( 0.0, 1.0, 1.0 ); glVertex3d( 0.0, 1.0, 0.0 );
-        
-        glNormal3d( 0.0, 0.0, 1.0 );
-        glVertex3d( 0.0, 0.0, 1.0 ); glVertex3d( 1.0, 0.0, 1.0 );
-        glVertex3d( 1.0, 1.0, 1.0 ); glVertex3d( 0.0, 1.0, 1.0 );
-        
-        glNormal3d( 0.0, 1.0, 0.0 );
-        glVertex3d( 0.0, 1.0, 0.0 ); glVertex3d( 0.0, 1.0, 1.0 );
-        glVertex3d( 1.0, 1.0, 1.0 ); glVertex3d( 1.0, 1.0, 0.0 );
-        
-        glNormal3d( 1.0, 0.0, 0.0 );
-        glVertex3d( 1.0, 0.0, 0.0 ); glVertex3d( 1.0, 1.0, 0.0 );
-        glVertex3d( 1.0, 1.0, 1.0 ); glVertex3d( 1.0, 0.0, 1.0 );
-        
-        glEnd();
+        ModelMeshCache::Instance()->get(ModelMeshKey(ModelMeshKey::MESH_BOX))->draw();
         
         /* restore the model matrix stack, and switch back to the matrix
         mode we were in. */
@@ -296,27 +379,17 @@ void drawBox( double x, double y, double z )
 
 void drawTextureBox( double x, double y, double z )
 {
+    /* no backend has textures, so every one draws it as a plain box. */
+    drawBox( x, y, z );
 }
 
 void drawCylinder( double h, double r1, double r2 )
 {
     ModelerDrawState *mds = ModelerDrawState::Instance();
-    int divisions;
+    int divisions = getQualityDivisions();
 
 	_setupOpenGl();
     
-    switch(mds->m_quality)
-    {
-    case HIGH: 
-        divisions = 32; break;
-    case MEDIUM: 
-        divisions = 20; break;
-    case LOW:
-        divisions = 12; break;
-    case POOR:
-        divisions = 8; break;
-    }
-    
     if (mds->m_rayFile)
     {
         _dump_current_modelview();
@@ -326,56 +399,7 @@ void drawCylinder( double h, double r1, double r2 )
         fprintf(mds->m_rayFile, "})\n" );
     }
     else
-    {
-        GLUquadricObj* gluq;
-        
-        /* GLU will again do the work.  draw the sides of the cylinder. */
-        gluq = gluNewQuadric();
-        gluQuadricDrawStyle( gluq, GLU_FILL );
-        gluQuadricTexture( gluq, GL_TRUE );
-        gluCylinder( gluq, r1, r2, h, divisions, divisions);
-        gluDeleteQuadric( gluq );
-        
-        if ( r1 > 0.0 )
-        {
-        /* if the r1 end does not come to a point, draw a flat disk to
-            cover it up. */
-            
-            gluq = gluNewQuadric();
-            gluQuadricDrawStyle( gluq, GLU_FILL );
-            gluQuadricTexture( gluq, GL_TRUE );
-            gluQuadricOrientation( gluq, GLU_INSIDE );
-            gluDisk( gluq, 0.0, r1, divisions, divisions);
-            gluDeleteQuadric( gluq );
-        }
-        
-        if ( r2 > 0.0 )
-        {
-        /* if the r2 end does not come to a point, draw a flat disk to
-            cover it up. */
-            
-            /* save the current matrix mode. */	
-            int savemode;
-            glGetIntegerv( GL_MATRIX_MODE, &savemode );
-            
-            /* translate the origin to the other end of the cylinder. */
-            glMatrixMode( GL_MODELVIEW );
-            glPushMatrix();
-            glTranslated( 0.0, 0.0, h );
-            
-            /* draw a disk centered at the new origin. */
-            gluq = gluNewQuadric();
-            gluQuadricDrawStyle( gluq, GLU_FILL );
-            gluQuadricTexture( gluq, GL_TRUE );
-            gluQuadricOrientation( gluq, GLU_OUTSIDE );
-            gluDisk( gluq, 0.0, r2, divisions, divisions);
-            gluDeleteQuadric( gluq );
-            
-            /* restore the matrix stack and mode. */
-            glPopMatrix();
-            glMatrixMode( savemode );
-        }
-    }
+        _draw_cylinder_mesh( divisions, h, r1, r2 );
     
 }
 void drawTriangle( double x1, double y1, double z1,
@@ -394,6 +418,13 @@ void drawTriangle( double x1, double y1, double z1,
         _dump_current_material();
         fprintf(mds->m_rayFile, "})\n" );
     }
+    else if (mds->m_raster)
+    {
+        const double p1[3] = { x1, y1, z1 };
+        const double p2[3] = { x2, y2, z2 };
+        const double p3[3] = { x3, y3, z3 };
+        mds->m_raster->drawTriangle(p1, p2, p3);
+    }
     else
     {
         double a, b, c, d, e, f;
@@ -418,40 +449,6 @@ void drawTriangle( double x1, double y1, double z1,
 
 
 void drawPolygon(int n, double h, double r1, double r2) {
-    GLUquadricObj* gluq;
-
-    /* GLU will again do the work.  draw the sides of the cylinder. */
-    gluq = gluNewQuadric();
-    gluQuadricDrawStyle(gluq, GLU_FILL);
-    gluQuadricTexture(gluq, GL_TRUE);
-    gluCylinder(gluq, r1, r2, h, n, n);
-    gluDeleteQuadric(gluq);
-
-    if (r1 > 0.0) {
-        gluq = gluNewQuadric();
-        gluQuadricDrawStyle(gluq, GLU_FILL);
-        gluQuadricTexture(gluq, GL_TRUE);
-        gluQuadricOrientation(gluq, GLU_INSIDE);
-        gluDisk(gluq, 0.0, r1, n, n);
-        gluDeleteQuadric(gluq);
-    }
-
-    if (r2 > 0.0) {
-        int savemode;
-        glGetIntegerv(GL_MATRIX_MODE, &savemode);
-
-        glMatrixMode(GL_MODELVIEW);
-        glPushMatrix();
-        glTranslated(0.0, 0.0, h);
-
-        gluq = gluNewQuadric();
-        gluQuadricDrawStyle(gluq, GLU_FILL);
-        gluQuadricTexture(gluq, GL_TRUE);
-        gluQuadricOrientation(gluq, GLU_OUTSIDE);
-        gluDisk(gluq, 0.0, r2, n, n);
-        gluDeleteQuadric(gluq);
-
-        glPopMatrix();
-        glMatrixMode(savemode);
-    }
+    _setupOpenGl();
+    _draw_cylinder_mesh(n, h, r1, r2);
 }
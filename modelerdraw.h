@@ -10,6 +10,7 @@
 
 #include "modelerglobals.h"
 
+class ModelerRaster;
 
 enum DrawModeSetting_t 
 { NONE=0, NORMAL, WIREFRAME, FLATSHADE, };
@@ -27,6 +28,10 @@ public:
 
 	FILE* m_rayFile;
 
+	// when set, the primitives are drawn by this software renderer
+	// instead of OpenGL (see modelerraster.h)
+	ModelerRaster* m_raster;
+
 	DrawModeSetting_t m_drawMode;
 	QualitySetting_t  m_quality;
 
@@ -35,6 +40,13 @@ public:
 	GLfloat m_specularColor[4];
 	GLfloat m_shininess;
 
+	// what was last given to OpenGL, so only changes are sent
+	// material bits: ambient 1, diffuse 2, specular 4, shininess 8;
+	// a property never set keeps the OpenGL default
+	int m_appliedDrawMode;		// -1 when unknown
+	int m_materialSet;
+	int m_materialDirty;
+
 private:
 	ModelerDrawState();
 	ModelerDrawState(const ModelerDrawState &) {}
@@ -53,7 +65,8 @@ private:
 // can handle it.
 //
 // Note:  Depending on whether a ray file is open or closed, these functions
-//        will either output to a ray file or make OpenGL calls.
+//        will either output to a ray file or make OpenGL calls; while
+//        ModelerDrawState::m_raster is set they draw into it instead.
 // ****************************************************************************
 
 // Set the current material properties
@@ -68,6 +81,20 @@ void setDrawMode(DrawModeSetting_t drawMode);
 // Set the current quality mode (See QualityModeSetting_t for valid values
 void setQuality(QualitySetting_t quality);
 
+// Number of divisions of round primitives for the current quality,
+// or for a given one (see ModelRenderQueue::selectQuality)
+int getQualityDivisions();
+int getQualityDivisions(QualitySetting_t quality);
+
+// The functions above only record the state; it is sent to OpenGL by the
+// primitives below, or by applyDrawState(), and only where it changed;
+// nothing is sent while a raster is set
+void applyDrawState();
+
+// Forget what OpenGL was given (new context, or state changed elsewhere),
+// so the next applyDrawState() sends everything again
+void invalidateDrawState();
+
 // Opens a .ray file for writing, returns false on error
 bool openRayFile(const char rayFileName[]);
 // Closes the current .ray file if one exists
@@ -84,6 +111,7 @@ void drawSphere(double r);
 void drawBox( double x, double y, double z );
 
 // Draw an axis-aligned texture box from origin to (x,y,z)
+// (untextured for now, the same as drawBox in every backend)
 void drawTextureBox( double x, double y, double z );
 
 // Draw a cylinder from z=0 to z=h with radius r1 at origin and r2 at z=h
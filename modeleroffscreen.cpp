@@ -0,0 +1,157 @@
+#include "modeleroffscreen.h"
+
+#include <cstddef>
+
+#ifdef ANIMATOR_OSMESA
+#include <GL/osmesa.h>
+#else
+#include <windows.h>
+#endif
+
+ModelerOffscreen::ModelerOffscreen() :
+m_width(0),
+m_height(0),
+m_context(NULL),
+m_device(NULL),
+m_bitmap(NULL),
+m_bitmapOld(NULL),
+m_pixels(NULL)
+{
+}
+
+ModelerOffscreen::~ModelerOffscreen()
+{
+	destroy();
+}
+
+#ifdef ANIMATOR_OSMESA
+
+bool ModelerOffscreen::create(int width, int height)
+{
+	destroy();
+	if (width <= 0 || height <= 0) return false;
+
+	OSMesaContext context = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+	if (context == NULL) return false;
+
+	m_context = context;
+	m_pixels = new unsigned char[4 * width * height];
+	m_width = width;
+	m_height = height;
+
+	if (!makeCurrent()) {
+		destroy();
+		return false;
+	}
+	return true;
+}
+
+void ModelerOffscreen::destroy()
+{
+	if (m_context != NULL)
+		OSMesaDestroyContext((OSMesaContext)m_context);
+	delete [] m_pixels;
+
+	m_context = NULL;
+	m_pixels = NULL;
+	m_width = 0;
+	m_height = 0;
+}
+
+bool ModelerOffscreen::makeCurrent()
+{
+	if (m_context == NULL) return false;
+	return OSMesaMakeCurrent((OSMesaContext)m_context, m_pixels, GL_UNSIGNED_BYTE, m_width, m_height) == GL_TRUE;
+}
+
+#else
+
+bool ModelerOffscreen::create(int width, int height)
+{
+	destroy();
+	if (width <= 0 || height <= 0) return false;
+
+	// the context draws straight into a DIB section selected into a memory DC
+	HDC hdc = CreateCompatibleDC(NULL);
+	if (hdc == NULL) return false;
+	m_device = hdc;
+
+	BITMAPINFO bmi;
+	ZeroMemory(&bmi, sizeof(bmi));
+	bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	bmi.bmiHeader.biWidth = width;
+	bmi.bmiHeader.biHeight = height;
+	bmi.bmiHeader.biPlanes = 1;
+	bmi.bmiHeader.biBitCount = 32;
+	bmi.bmiHeader.biCompression = BI_RGB;
+
+	void* bits = NULL;
+	HBITMAP hbitmap = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+	if (hbitmap == NULL) {
+		destroy();
+		return false;
+	}
+	m_bitmap = hbitmap;
+	m_bitmapOld = SelectObject(hdc, hbitmap);
+
+	PIXELFORMATDESCRIPTOR pfd;
+	ZeroMemory(&pfd, sizeof(pfd));
+	pfd.nSize = sizeof(pfd);
+	pfd.nVersion = 1;
+	pfd.dwFlags = PFD_DRAW_TO_BITMAP | PFD_SUPPORT_OPENGL | PFD_SUPPORT_GDI;
+	pfd.iPixelType = PFD_TYPE_RGBA;
+	pfd.cColorBits = 32;
+	pfd.cDepthBits = 32;
+	pfd.iLayerType = PFD_MAIN_PLANE;
+
+	const int format = ChoosePixelFormat(hdc, &pfd);
+	if (format == 0 || !SetPixelFormat(hdc, format, &pfd)) {
+		destroy();
+		return false;
+	}
+
+	HGLRC hglrc = wglCreateContext(hdc);
+	if (hglrc == NULL) {
+		destroy();
+		return false;
+	}
+	m_context = hglrc;
+	m_width = width;
+	m_height = height;
+
+	if (!makeCurrent()) {
+		destroy();
+		return false;
+	}
+	return true;
+}
+
+void ModelerOffscreen::destroy()
+{
+	if (m_context != NULL) {
+		if (wglGetCurrentContext() == (HGLRC)m_context)
+			wglMakeCurrent(NULL, NULL);
+		wglDeleteContext((HGLRC)m_context);
+	}
+	if (m_bitmapOld != NULL)
+		SelectObject((HDC)m_device, (HGDIOBJ)m_bitmapOld);
+	if (m_bitmap != NULL)
+		DeleteObject((HGDIOBJ)m_bitmap);
+	if (m_device != NULL)
+		DeleteDC((HDC)m_device);
+
+	m_context = NULL;
+	m_device = NULL;
+	m_bitmap = NULL;
+	m_bitmapOld = NULL;
+	m_width = 0;
+	m_height = 0;
+}
+
+bool ModelerOffscreen::makeCurrent()
+{
+	if (m_context == NULL) return false;
+	return wglMakeCurrent((HDC)m_device, (HGLRC)m_context) == TRUE;
+}
+
+#endif
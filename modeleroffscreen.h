@@ -0,0 +1,43 @@
+// modeleroffscreen.h
+
+// An OpenGL context that renders into memory instead of a window, so
+// frames can be drawn on machines without a display.  Built on OSMesa
+// when ANIMATOR_OSMESA is defined, otherwise on the software OpenGL
+// that Windows provides for memory bitmaps.
+
+#ifndef MODELEROFFSCREEN_H
+#define MODELEROFFSCREEN_H
+
+class ModelerOffscreen
+{
+public:
+	ModelerOffscreen();
+	~ModelerOffscreen();
+
+	// Create a width x height context and make it current;
+	// returns false when no offscreen context is available
+	bool create(int width, int height);
+	void destroy();
+
+	bool makeCurrent();
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+
+private:
+	ModelerOffscreen(const ModelerOffscreen&);
+	ModelerOffscreen& operator=(const ModelerOffscreen&);
+
+	int m_width;
+	int m_height;
+
+	// OSMesa: context and color buffer
+	// Windows: rendering context, memory DC, DIB section and the bitmap it replaced
+	void* m_context;
+	void* m_device;
+	void* m_bitmap;
+	void* m_bitmapOld;
+	unsigned char* m_pixels;
+};
+
+#endif
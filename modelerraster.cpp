@@ -0,0 +1,636 @@
+#include "modelerraster.h"
+#include "modelerdraw.h"
+#include "ModelMesh.h"
+#include "parallel.h"
+
+#include <cstddef>
+#include <cstring>
+#include <math.h>
+
+// SSE2 is part of every x64 target and of x86 builds with /arch:SSE2,
+// so unlike the SSSE3 path of bitmap.cpp no runtime check is needed
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+// fixed function defaults the raster reproduces
+static const float kSceneAmbient = 0.2f;
+static const float kDefaultAmbient = 0.2f;
+static const float kDefaultDiffuse = 0.8f;
+
+// material bits of ModelerDrawState::m_materialSet
+static const int kMaterialAmbient   = 1;
+static const int kMaterialDiffuse   = 2;
+static const int kMaterialSpecular  = 4;
+static const int kMaterialShininess = 8;
+
+// a wireframe pixel is closer than this to an edge of its triangle
+static const float kWireWidth = 0.5f;
+
+// what OpenGL would light with: a property never set keeps its default
+void ModelerRaster::getMaterial(Material& material)
+{
+	const ModelerDrawState *mds = ModelerDrawState::Instance();
+	const int set = mds->m_materialSet;
+
+	for (int i = 0; i < 3; ++i)
+	{
+		material.ambient[i]  = (set & kMaterialAmbient)  ? mds->m_ambientColor[i]  : kDefaultAmbient;
+		material.diffuse[i]  = (set & kMaterialDiffuse)  ? mds->m_diffuseColor[i]  : kDefaultDiffuse;
+		material.specular[i] = (set & kMaterialSpecular) ? mds->m_specularColor[i] : 0.0f;
+	}
+	material.shininess = (set & kMaterialShininess) ? mds->m_shininess : 0.0f;
+}
+
+static void _transform_point(const Mat4d& m, const double* p, double* out, int size)
+{
+	for (int i = 0; i < size; ++i)
+		out[i] = m.n[i * 4] * p[0] + m.n[i * 4 + 1] * p[1] + m.n[i * 4 + 2] * p[2] + m.n[i * 4 + 3];
+}
+
+// cofactors of the upper 3x3, the inverse transpose up to a scale;
+// the sign of the determinant keeps normals pointing out of mirrored objects
+static void _normal_matrix(const Mat4d& m, double* out)
+{
+	const double* n = m.n;
+	out[0] = n[5] * n[10] - n[6] * n[9];
+	out[1] = n[6] * n[8]  - n[4] * n[10];
+	out[2] = n[4] * n[9]  - n[5] * n[8];
+	out[3] = n[2] * n[9]  - n[1] * n[10];
+	out[4] = n[0] * n[10] - n[2] * n[8];
+	out[5] = n[1] * n[8]  - n[0] * n[9];
+	out[6] = n[1] * n[6]  - n[2] * n[5];
+	out[7] = n[2] * n[4]  - n[0] * n[6];
+	out[8] = n[0] * n[5]  - n[1] * n[4];
+
+	const double det = n[0] * out[0] + n[1] * out[1] + n[2] * out[2];
+	if (det < 0)
+		for (int i = 0; i < 9; ++i) out[i] = -out[i];
+}
+
+ModelerRaster::ModelerRaster() :
+m_width(0),
+m_height(0),
+m_stride(0),
+m_tileX(0),
+m_tileY(0)
+{
+	begin(Mat4d(), Mat4d());
+}
+
+ModelerRaster::~ModelerRaster()
+{
+}
+
+bool ModelerRaster::create(int width, int height)
+{
+	if (width <= 0 || height <= 0) return false;
+
+	m_width = width;
+	m_height = height;
+	m_tileX = (width + kTileSize - 1) / kTileSize;
+	m_tileY = (height + kTileSize - 1) / kTileSize;
+
+	// whole tiles per row, so 4 pixel spans never leave their tile
+	m_stride = m_tileX * kTileSize;
+
+	m_bins.assign(m_tileX * m_tileY, std::vector<int>());
+	m_depth.assign(m_stride * height, 1.0f);
+	m_color.assign(m_stride * height, 0);
+	m_pixels.assign(3 * width * height, 0);
+	return true;
+}
+
+void ModelerRaster::begin(const Mat4d& projection, const Mat4d& view)
+{
+	m_projection = projection;
+	m_view = view;
+	m_model = Mat4d();
+	m_triangles.clear();
+
+	// GL_LIGHT0 is white and GL_LIGHT1 black, both along +z of the eye
+	for (int i = 0; i < kLightCount; ++i)
+	{
+		const float level = (i == 0) ? 1.0f : 0.0f;
+		m_lightPosition[i][0] = 0;
+		m_lightPosition[i][1] = 0;
+		m_lightPosition[i][2] = 1;
+		m_lightPosition[i][3] = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			m_lightDiffuse[i][k] = level;
+			m_lightSpecular[i][k] = level;
+		}
+	}
+}
+
+void ModelerRaster::setLight(int index, const float* position, const float* diffuse)
+{
+	if (index < 0 || index >= kLightCount) return;
+
+	// the 4x4 applies to w as well, so directions stay directions
+	double eye[4];
+	for (int i = 0; i < 4; ++i)
+		eye[i] = m_view.n[i * 4] * position[0] + m_view.n[i * 4 + 1] * position[1] +
+			m_view.n[i * 4 + 2] * position[2] + m_view.n[i * 4 + 3] * position[3];
+
+	if (eye[3] == 0)
+	{
+		const double length = sqrt(eye[0] * eye[0] + eye[1] * eye[1] + eye[2] * eye[2]);
+		if (length > 0)
+			for (int i = 0; i < 3; ++i) eye[i] /= length;
+	}
+
+	for (int i = 0; i < 4; ++i) m_lightPosition[index][i] = (float)eye[i];
+	for (int i = 0; i < 3; ++i) m_lightDiffuse[index][i] = diffuse[i];
+}
+
+void ModelerRaster::setModel(const Mat4d& model)
+{
+	m_model = model;
+}
+
+// like the fixed function pipeline: scene ambient, then diffuse and
+// Blinn specular of each light with the viewer at infinity
+void ModelerRaster::lightVertex(const Material& material, const double* position, const double* normal, float* color) const
+{
+	for (int k = 0; k < 3; ++k)
+		color[k] = material.ambient[k] * kSceneAmbient;
+
+	for (int i = 0; i < kLightCount; ++i)
+	{
+		const float* light = m_lightPosition[i];
+
+		double L[3] = { light[0], light[1], light[2] };
+		if (light[3] != 0)
+		{
+			double length = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				L[k] = light[k] / light[3] - position[k];
+				length += L[k] * L[k];
+			}
+			length = sqrt(length);
+			if (length > 0)
+				for (int k = 0; k < 3; ++k) L[k] /= length;
+		}
+
+		const double diffuse = normal[0] * L[0] + normal[1] * L[1] + normal[2] * L[2];
+		if (diffuse <= 0) continue;
+
+		double H[3] = { L[0], L[1], L[2] + 1 };
+		const double length = sqrt(H[0] * H[0] + H[1] * H[1] + H[2] * H[2]);
+		double specular = 0;
+		if (length > 0)
+		{
+			specular = (normal[0] * H[0] + normal[1] * H[1] + normal[2] * H[2]) / length;
+			specular = pow(specular > 0 ? specular : 0, (double)material.shininess);
+		}
+
+		for (int k = 0; k < 3; ++k)
+			color[k] += (float)(diffuse * m_lightDiffuse[i][k] * material.diffuse[k] +
+				specular * m_lightSpecular[i][k] * material.specular[k]);
+	}
+
+	for (int k = 0; k < 3; ++k)
+		color[k] = color[k] < 0 ? 0 : color[k] > 1 ? 1 : color[k];
+}
+
+void ModelerRaster::drawMesh(const ModelMesh& mesh, const Mat4d& local)
+{
+	const size_t vertexCount = mesh.vertex_list.size() / 3;
+	if (vertexCount == 0 || mesh.index_list.empty()) return;
+
+	const Mat4d eye = m_view * m_model * local;
+	const Mat4d clip = m_projection * eye;
+	double normalMatrix[9];
+	_normal_matrix(eye, normalMatrix);
+
+	Material material;
+	getMaterial(material);
+
+	// every vertex lit once, then shared by its triangles
+	m_vertices.resize(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		const double p[3] = { mesh.vertex_list[v * 3], mesh.vertex_list[v * 3 + 1], mesh.vertex_list[v * 3 + 2] };
+		const double n[3] = { mesh.normal_list[v * 3], mesh.normal_list[v * 3 + 1], mesh.normal_list[v * 3 + 2] };
+
+		double position[3];
+		double normal[3];
+		_transform_point(eye, p, position, 3);
+		_transform_point(clip, p, m_vertices[v].m_clip, 4);
+
+		double length = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			normal[k] = normalMatrix[k * 3] * n[0] + normalMatrix[k * 3 + 1] * n[1] + normalMatrix[k * 3 + 2] * n[2];
+			length += normal[k] * normal[k];
+		}
+		length = sqrt(length);
+		if (length > 0)
+			for (int k = 0; k < 3; ++k) normal[k] /= length;
+
+		lightVertex(material, position, normal, m_vertices[v].m_color);
+	}
+
+	const bool flat = ModelerDrawState::Instance()->m_drawMode != NORMAL;
+	const size_t indexCount = mesh.index_list.size() - mesh.index_list.size() % 3;
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		const GLuint* index = &mesh.index_list[i];
+		if (index[0] >= vertexCount || index[1] >= vertexCount || index[2] >= vertexCount) continue;
+
+		// GL_FLAT takes the color of the last vertex
+		const Vertex triangle[3] = { m_vertices[index[0]], m_vertices[index[1]], m_vertices[index[2]] };
+		addTriangle(triangle, flat ? triangle[2].m_color : NULL);
+	}
+}
+
+void ModelerRaster::drawTriangle(const double* p0, const double* p1, const double* p2)
+{
+	const Mat4d eye = m_view * m_model;
+	const Mat4d clip = m_projection * eye;
+	double normalMatrix[9];
+	_normal_matrix(eye, normalMatrix);
+
+	Material material;
+	getMaterial(material);
+
+	// one normal, the cross product of two edges
+	const double a[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	const double b[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+	const double n[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+
+	double normal[3];
+	double length = 0;
+	for (int k = 0; k < 3; ++k)
+	{
+		normal[k] = normalMatrix[k * 3] * n[0] + normalMatrix[k * 3 + 1] * n[1] + normalMatrix[k * 3 + 2] * n[2];
+		length += normal[k] * normal[k];
+	}
+	length = sqrt(length);
+	if (length > 0)
+		for (int k = 0; k < 3; ++k) normal[k] /= length;
+
+	Vertex triangle[3];
+	const double* p[3] = { p0, p1, p2 };
+	for (int v = 0; v < 3; ++v)
+	{
+		double position[3];
+		_transform_point(eye, p[v], position, 3);
+		_transform_point(clip, p[v], triangle[v].m_clip, 4);
+		lightVertex(material, position, normal, triangle[v].m_color);
+	}
+
+	const bool flat = ModelerDrawState::Instance()->m_drawMode != NORMAL;
+	addTriangle(triangle, flat ? triangle[2].m_color : NULL);
+}
+
+// clip against the view volume, then fan the polygon into triangles
+void ModelerRaster::addTriangle(const Vertex* vertex, const float* flatColor)
+{
+	// distance to the planes x = -w, x = w, y = -w, y = w, z = -w, z = w
+	int outside = 0;
+	for (int v = 0; v < 3; ++v)
+	{
+		const double* c = vertex[v].m_clip;
+		for (int plane = 0; plane < 6; ++plane)
+		{
+			const double d = (plane & 1) ? c[3] - c[plane >> 1] : c[3] + c[plane >> 1];
+			if (d < 0) outside |= 1 << plane;
+		}
+	}
+
+	if (outside == 0)
+	{
+		setupTriangle(vertex[0], vertex[1], vertex[2], flatColor);
+		return;
+	}
+
+	// Sutherland-Hodgman, a triangle gains at most one vertex per plane
+	Vertex polygon[2][9];
+	int count = 3;
+	memcpy(polygon[0], vertex, 3 * sizeof(Vertex));
+
+	int current = 0;
+	for (int plane = 0; plane < 6 && count >= 3; ++plane)
+	{
+		if (!(outside & (1 << plane))) continue;
+
+		const Vertex* in = polygon[current];
+		Vertex* out = polygon[current ^ 1];
+		int outCount = 0;
+
+		for (int i = 0; i < count; ++i)
+		{
+			const Vertex& a = in[i];
+			const Vertex& b = in[(i + 1) % count];
+			const double da = (plane & 1) ? a.m_clip[3] - a.m_clip[plane >> 1] : a.m_clip[3] + a.m_clip[plane >> 1];
+			const double db = (plane & 1) ? b.m_clip[3] - b.m_clip[plane >> 1] : b.m_clip[3] + b.m_clip[plane >> 1];
+
+			if (da >= 0) out[outCount++] = a;
+			if ((da >= 0) != (db >= 0))
+			{
+				const double t = da / (da - db);
+				Vertex& split = out[outCount++];
+				for (int k = 0; k < 4; ++k)
+					split.m_clip[k] = a.m_clip[k] + t * (b.m_clip[k] - a.m_clip[k]);
+				for (int k = 0; k < 3; ++k)
+					split.m_color[k] = (float)(a.m_color[k] + t * (b.m_color[k] - a.m_color[k]));
+			}
+		}
+
+		count = outCount;
+		current ^= 1;
+	}
+
+	for (int i = 1; i + 1 < count; ++i)
+		setupTriangle(polygon[current][0], polygon[current][i], polygon[current][i + 1], flatColor);
+}
+
+// screen coordinates have y up, so row 0 is the bottom of the frame
+void ModelerRaster::setupTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, const float* flatColor)
+{
+	const Vertex* vertex[3] = { &v0, &v1, &v2 };
+	double x[3], y[3], z[3], w[3];
+	for (int v = 0; v < 3; ++v)
+	{
+		const double* c = vertex[v]->m_clip;
+		if (!(c[3] > 0)) return;
+		w[v] = 1.0 / c[3];
+		x[v] = (c[0] * w[v] + 1) * 0.5 * m_width;
+		y[v] = (c[1] * w[v] + 1) * 0.5 * m_height;
+		z[v] = (c[2] * w[v] + 1) * 0.5;
+	}
+
+	double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (!(area != 0)) return;
+
+	// counterclockwise on screen, there is no culling
+	int order[3] = { 0, 1, 2 };
+	if (area < 0)
+	{
+		order[1] = 2;
+		order[2] = 1;
+		area = -area;
+	}
+
+	Triangle triangle;
+	triangle.m_wire = ModelerDrawState::Instance()->m_drawMode == WIREFRAME;
+
+	// edge i is opposite vertex i, from vertex i + 1 to i + 2; its function
+	// is the area with the pixel, so edge i / area is the weight of vertex i
+	double edge[3][3];
+	for (int i = 0; i < 3; ++i)
+	{
+		const int a = order[(i + 1) % 3];
+		const int b = order[(i + 2) % 3];
+		const double dx = x[b] - x[a];
+		const double dy = y[b] - y[a];
+
+		// shared edges are evaluated from the same end with the signs
+		// flipped, so neighbours agree on every pixel
+		const bool flip = (x[a] > x[b]) || (x[a] == x[b] && y[a] > y[b]);
+		const int origin = flip ? b : a;
+		edge[i][0] = -dy;
+		edge[i][1] = dx;
+		edge[i][2] = dy * x[origin] - dx * y[origin];
+
+		for (int k = 0; k < 3; ++k) triangle.m_edge[i][k] = (float)edge[i][k];
+
+		// interior on the left; top edges run left, left edges run down
+		triangle.m_topLeft[i] = (dy == 0 && dx < 0) || dy < 0;
+		const double length = sqrt(dx * dx + dy * dy);
+		triangle.m_edgeScale[i] = (float)(1.0 / length);
+	}
+
+	// attribute planes: value = sum of vertex value * edge / area
+	double color[3][3];
+	for (int i = 0; i < 3; ++i)
+	{
+		const float* c = flatColor ? flatColor : vertex[order[i]]->m_color;
+		for (int k = 0; k < 3; ++k) color[i][k] = c[k] * w[order[i]];
+	}
+
+	for (int k = 0; k < 3; ++k)
+	{
+		triangle.m_z[k] = (float)((z[order[0]] * edge[0][k] + z[order[1]] * edge[1][k] + z[order[2]] * edge[2][k]) / area);
+		triangle.m_w[k] = (float)((w[order[0]] * edge[0][k] + w[order[1]] * edge[1][k] + w[order[2]] * edge[2][k]) / area);
+		for (int c = 0; c < 3; ++c)
+			triangle.m_color[c][k] = (float)((color[0][c] * edge[0][k] + color[1][c] * edge[1][k] + color[2][c] * edge[2][k]) / area);
+	}
+
+	// pixel centers inside the bounds, clamped to the frame
+	double bound[4] = { x[0], y[0], x[0], y[0] };
+	for (int v = 1; v < 3; ++v)
+	{
+		bound[0] = x[v] < bound[0] ? x[v] : bound[0];
+		bound[1] = y[v] < bound[1] ? y[v] : bound[1];
+		bound[2] = x[v] > bound[2] ? x[v] : bound[2];
+		bound[3] = y[v] > bound[3] ? y[v] : bound[3];
+	}
+	triangle.m_bound[0] = (int)floor(bound[0]);
+	triangle.m_bound[1] = (int)floor(bound[1]);
+	triangle.m_bound[2] = (int)ceil(bound[2]);
+	triangle.m_bound[3] = (int)ceil(bound[3]);
+	if (triangle.m_bound[0] < 0) triangle.m_bound[0] = 0;
+	if (triangle.m_bound[1] < 0) triangle.m_bound[1] = 0;
+	if (triangle.m_bound[2] > m_width - 1) triangle.m_bound[2] = m_width - 1;
+	if (triangle.m_bound[3] > m_height - 1) triangle.m_bound[3] = m_height - 1;
+	if (triangle.m_bound[0] > triangle.m_bound[2] || triangle.m_bound[1] > triangle.m_bound[3]) return;
+
+	m_triangles.push_back(triangle);
+}
+
+void ModelerRaster::end()
+{
+	if (m_width <= 0 || m_height <= 0) return;
+
+	// bins keep the order of submission, so the frame does not depend on
+	// how the tiles are spread over the threads
+	for (size_t i = 0; i < m_bins.size(); ++i)
+		m_bins[i].clear();
+
+	const int triangleCount = (int)m_triangles.size();
+	for (int t = 0; t < triangleCount; ++t)
+	{
+		const int* bound = m_triangles[t].m_bound;
+		for (int ty = bound[1] / kTileSize; ty <= bound[3] / kTileSize; ++ty)
+			for (int tx = bound[0] / kTileSize; tx <= bound[2] / kTileSize; ++tx)
+				m_bins[ty * m_tileX + tx].push_back(t);
+	}
+
+	parallelFor(m_tileX * m_tileY, [this](int tile) { rasterTile(tile); });
+
+	m_triangles.clear();
+}
+
+void ModelerRaster::rasterTile(int tile)
+{
+	const int x0 = (tile % m_tileX) * kTileSize;
+	const int y0 = (tile / m_tileX) * kTileSize;
+	const int x1 = (x0 + kTileSize < m_width ? x0 + kTileSize : m_width) - 1;
+	const int y1 = (y0 + kTileSize < m_height ? y0 + kTileSize : m_height) - 1;
+
+	// clear
+	for (int y = y0; y <= y1; ++y)
+	{
+		float* depth = &m_depth[y * m_stride + x0];
+		unsigned int* color = &m_color[y * m_stride + x0];
+		for (int x = 0; x < kTileSize; ++x)
+		{
+			depth[x] = 1.0f;
+			color[x] = 0;
+		}
+	}
+
+	const std::vector<int>& bin = m_bins[tile];
+	for (size_t i = 0; i < bin.size(); ++i)
+	{
+		const Triangle& triangle = m_triangles[bin[i]];
+
+		// spans of 4 start at a multiple of 4, the tile start is one
+		const int bx0 = (triangle.m_bound[0] > x0 ? triangle.m_bound[0] : x0) & ~3;
+		const int by0 = triangle.m_bound[1] > y0 ? triangle.m_bound[1] : y0;
+		const int bx1 = triangle.m_bound[2] < x1 ? triangle.m_bound[2] : x1;
+		const int by1 = triangle.m_bound[3] < y1 ? triangle.m_bound[3] : y1;
+
+#ifdef RASTER_SSE2
+		const __m128 offset = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 wire = _mm_set1_ps(kWireWidth);
+		const __m128 scale = _mm_set1_ps(255.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+
+		__m128 edgeA[3], edgeScale[3], colorA[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			edgeA[k] = _mm_set1_ps(triangle.m_edge[k][0]);
+			edgeScale[k] = _mm_set1_ps(triangle.m_edgeScale[k]);
+			colorA[k] = _mm_set1_ps(triangle.m_color[k][0]);
+		}
+		const __m128 zA = _mm_set1_ps(triangle.m_z[0]);
+		const __m128 wA = _mm_set1_ps(triangle.m_w[0]);
+
+		for (int y = by0; y <= by1; ++y)
+		{
+			const float fy = y + 0.5f;
+
+			// a * x + (b * y + c), the same sum for both sides of a shared edge
+			__m128 edgeRow[3], colorRow[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				edgeRow[k] = _mm_set1_ps(triangle.m_edge[k][1] * fy + triangle.m_edge[k][2]);
+				colorRow[k] = _mm_set1_ps(triangle.m_color[k][1] * fy + triangle.m_color[k][2]);
+			}
+			const __m128 zRow = _mm_set1_ps(triangle.m_z[1] * fy + triangle.m_z[2]);
+			const __m128 wRow = _mm_set1_ps(triangle.m_w[1] * fy + triangle.m_w[2]);
+
+			float* depthRow = &m_depth[y * m_stride];
+			unsigned int* colorRowOut = &m_color[y * m_stride];
+
+			for (int x = bx0; x <= bx1; x += 4)
+			{
+				const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offset);
+
+				__m128 mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				__m128 onEdge = _mm_setzero_ps();
+				for (int k = 0; k < 3; ++k)
+				{
+					const __m128 e = _mm_add_ps(_mm_mul_ps(edgeA[k], px), edgeRow[k]);
+					mask = _mm_and_ps(mask, triangle.m_topLeft[k] ? _mm_cmpge_ps(e, zero) : _mm_cmpgt_ps(e, zero));
+					if (triangle.m_wire)
+						onEdge = _mm_or_ps(onEdge, _mm_cmplt_ps(_mm_mul_ps(e, edgeScale[k]), wire));
+				}
+				if (triangle.m_wire) mask = _mm_and_ps(mask, onEdge);
+				if (_mm_movemask_ps(mask) == 0) continue;
+
+				// GL_LESS against the z-buffer
+				const __m128 z = _mm_add_ps(_mm_mul_ps(zA, px), zRow);
+				const __m128 depth = _mm_loadu_ps(depthRow + x);
+				mask = _mm_and_ps(mask, _mm_cmplt_ps(z, depth));
+				if (_mm_movemask_ps(mask) == 0) continue;
+				_mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, depth)));
+
+				// color / w over 1 / w, rounded to 8 bit
+				const __m128 w = _mm_div_ps(scale, _mm_add_ps(_mm_mul_ps(wA, px), wRow));
+				__m128i channel[3];
+				for (int k = 0; k < 3; ++k)
+				{
+					__m128 c = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(colorA[k], px), colorRow[k]), w);
+					c = _mm_min_ps(_mm_max_ps(_mm_add_ps(c, half), zero), scale);
+					channel[k] = _mm_cvttps_epi32(c);
+				}
+				const __m128i rgb = _mm_or_si128(channel[0],
+					_mm_or_si128(_mm_slli_epi32(channel[1], 8), _mm_slli_epi32(channel[2], 16)));
+
+				const __m128i select = _mm_castps_si128(mask);
+				__m128i* out = (__m128i*)(colorRowOut + x);
+				const __m128i old = _mm_loadu_si128(out);
+				_mm_storeu_si128(out, _mm_or_si128(_mm_and_si128(select, rgb), _mm_andnot_si128(select, old)));
+			}
+		}
+#else
+		for (int y = by0; y <= by1; ++y)
+		{
+			const float fy = y + 0.5f;
+
+			float edgeRow[3], colorRow[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				edgeRow[k] = triangle.m_edge[k][1] * fy + triangle.m_edge[k][2];
+				colorRow[k] = triangle.m_color[k][1] * fy + triangle.m_color[k][2];
+			}
+			const float zRow = triangle.m_z[1] * fy + triangle.m_z[2];
+			const float wRow = triangle.m_w[1] * fy + triangle.m_w[2];
+
+			float* depthRow = &m_depth[y * m_stride];
+			unsigned int* colorRowOut = &m_color[y * m_stride];
+
+			for (int x = bx0; x <= bx1; ++x)
+			{
+				const float px = x + 0.5f;
+
+				bool inside = true;
+				bool onEdge = false;
+				for (int k = 0; k < 3; ++k)
+				{
+					const float e = triangle.m_edge[k][0] * px + edgeRow[k];
+					inside = inside && (triangle.m_topLeft[k] ? e >= 0 : e > 0);
+					onEdge = onEdge || e * triangle.m_edgeScale[k] < kWireWidth;
+				}
+				if (!inside || (triangle.m_wire && !onEdge)) continue;
+
+				const float z = triangle.m_z[0] * px + zRow;
+				if (!(z < depthRow[x])) continue;
+				depthRow[x] = z;
+
+				const float w = 255.0f / (triangle.m_w[0] * px + wRow);
+				unsigned int rgb = 0;
+				for (int k = 0; k < 3; ++k)
+				{
+					float c = (triangle.m_color[k][0] * px + colorRow[k]) * w + 0.5f;
+					c = c < 0 ? 0 : c > 255 ? 255 : c;
+					rgb |= (unsigned int)c << (8 * k);
+				}
+				colorRowOut[x] = rgb;
+			}
+		}
+#endif
+	}
+
+	// out to the packed RGB frame
+	for (int y = y0; y <= y1; ++y)
+	{
+		const unsigned int* color = &m_color[y * m_stride];
+		unsigned char* out = &m_pixels[3 * (y * m_width + x0)];
+		for (int x = x0; x <= x1; ++x, out += 3)
+		{
+			out[0] = (unsigned char)(color[x]);
+			out[1] = (unsigned char)(color[x] >> 8);
+			out[2] = (unsigned char)(color[x] >> 16);
+		}
+	}
+}
@@ -0,0 +1,120 @@
+// modelerraster.h
+
+// A software renderer for the modelerdraw.h primitives, so frames can be
+// drawn without any OpenGL context.  While ModelerDrawState::m_raster is
+// set, the primitives are lit per vertex like the fixed function pipeline
+// of ModelerView (two lights, material of ModelerDrawState) and kept as
+// screen triangles; end() bins them into tiles and fills the tiles in
+// parallel against a z-buffer.
+//
+// Only the primitives see the model matrix given by setModel(); OpenGL
+// transforms done around them (glTranslated, ...) are not seen.
+
+#ifndef MODELERRASTER_H
+#define MODELERRASTER_H
+
+#include <vector>
+#include "mat.h"
+
+class ModelMesh;
+
+class ModelerRaster
+{
+public:
+	ModelerRaster();
+	~ModelerRaster();
+
+	// Allocate a width x height frame; returns false for an empty size
+	bool create(int width, int height);
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+
+	// Start a frame: projection and view (world to eye) are row-major, the
+	// model matrix goes back to identity and the lights to the OpenGL defaults
+	void begin(const Mat4d& projection, const Mat4d& view);
+
+	// Like glLightfv for GL_POSITION and GL_DIFFUSE after the viewing
+	// transform: position is in world space, w = 0 for a directional light
+	void setLight(int index, const float* position, const float* diffuse);
+
+	// Object to world matrix of the primitives drawn next
+	void setModel(const Mat4d& model);
+
+	// Draw mesh with model * local, in the draw mode and material of ModelerDrawState
+	void drawMesh(const ModelMesh& mesh, const Mat4d& local);
+	void drawTriangle(const double* p0, const double* p1, const double* p2);
+
+	// Rasterize what was drawn since begin()
+	void end();
+
+	// RGB, rows bottom-up and tightly packed, like glReadPixels
+	const unsigned char* pixels() const { return m_pixels.empty() ? NULL : &m_pixels[0]; }
+
+	static const int kLightCount = 2;
+	static const int kTileSize = 64;
+
+private:
+	ModelerRaster(const ModelerRaster&);
+	ModelerRaster& operator=(const ModelerRaster&);
+
+	// a triangle set up in screen space: edge functions and the planes of
+	// z, 1/w and color/w, so each pixel is a few multiply-adds
+	struct Triangle
+	{
+		float m_edge[3][3];			// a, b, c of a*x + b*y + c, inside when >= 0
+		bool  m_topLeft[3];			// edge owns the pixels exactly on it
+		float m_edgeScale[3];		// 1 / length, pixel distance to the edge
+		float m_z[3];
+		float m_w[3];
+		float m_color[3][3];
+		bool  m_wire;
+		int   m_bound[4];			// x0, y0, x1, y1 in pixel, inclusive
+	};
+
+	struct Vertex
+	{
+		double m_clip[4];
+		float  m_color[3];
+	};
+
+	struct Material
+	{
+		float ambient[3];
+		float diffuse[3];
+		float specular[3];
+		float shininess;
+	};
+
+	static void getMaterial(Material& material);
+	void lightVertex(const Material& material, const double* position, const double* normal, float* color) const;
+	void addTriangle(const Vertex* vertex, const float* flatColor);
+	void setupTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, const float* flatColor);
+
+	void rasterTile(int tile);
+
+	int m_width;
+	int m_height;
+	int m_stride;					// floats per row of m_depth, a multiple of 4
+	int m_tileX;
+	int m_tileY;
+
+	Mat4d m_projection;
+	Mat4d m_view;
+	Mat4d m_model;
+
+	// eye space
+	float m_lightPosition[kLightCount][4];
+	float m_lightDiffuse[kLightCount][3];
+	float m_lightSpecular[kLightCount][3];
+
+	std::vector<Vertex> m_vertices;		// of the mesh being drawn
+	std::vector<Triangle> m_triangles;
+	std::vector< std::vector<int> > m_bins;
+
+	std::vector<float> m_depth;
+	std::vector<unsigned int> m_color;	// 0x00BBGGRR, m_stride per row
+	std::vector<unsigned char> m_pixels;
+};
+
+#endif
@@ -20,6 +20,8 @@
 #ifdef _DEBUG
 #include <assert.h>
 #endif _DEBUG
+#include <math.h>
+#include <stdlib.h>
 #include <string>
 #include <FL/fl_ask.h>
 
@@ -99,19 +101,51 @@ void ModelerUI::cb_saveBMPFile(Fl_Menu_* o, void* v)
 
 inline void ModelerUI::cb_saveMovie_i(Fl_Menu_*, void*)
 {
-	char *szFileName = fl_file_chooser("Save Movie As", "*.bmp", NULL);
+	char *szFileName = fl_file_chooser("Save Movie As", "*.{bmp,png,avi}", NULL);
 
 	if (szFileName) {
 		m_strMovieFileName = szFileName;
+		capture_format_t format = CAPTURE_BMP;
 
-		// Remove the .bmp part
+		// Remove the .bmp, .png or .avi part
 		char szExt[_MAX_EXT];
 		_splitpath(m_strMovieFileName.c_str(), NULL, NULL, NULL, szExt);
 		if (!stricmp(szExt, ".bmp"))
 			m_strMovieFileName = m_strMovieFileName.substr(0, m_strMovieFileName.length() - 4);
+		else if (!stricmp(szExt, ".png")) {
+			m_strMovieFileName = m_strMovieFileName.substr(0, m_strMovieFileName.length() - 4);
+			format = CAPTURE_PNG;
+
+			// cancelling keeps the previous level
+			char szLevel[16];
+			_snprintf(szLevel, 16, "%d", m_iMovieLevel);
+			szLevel[15] = 0;
+			const char* szInput = fl_input("PNG compression level (0 fastest - 9 smallest)", szLevel);
+			if (szInput) {
+				int iLevel = atoi(szInput);
+				m_iMovieLevel = (iLevel < 0) ? 0 : (iLevel > 9) ? 9 : iLevel;
+			}
+		}
+		else if (!stricmp(szExt, ".avi")) {
+			m_strMovieFileName = m_strMovieFileName.substr(0, m_strMovieFileName.length() - 4);
+			format = CAPTURE_AVI;
+
+			char szQuality[16];
+			_snprintf(szQuality, 16, "%d", m_iMovieQuality);
+			szQuality[15] = 0;
+			const char* szInput = fl_input("JPEG quality (1 smallest - 100 best)", szQuality);
+			if (szInput) {
+				int iQuality = atoi(szInput);
+				m_iMovieQuality = (iQuality < 1) ? 1 : (iQuality > 100) ? 100 : iQuality;
+			}
+		}
+
+		// one frame per 1/fps from play start to play end
+		const int iFrameHint = int((m_fPlayEndTime - m_fPlayStartTime) * m_iFps) + 1;
 
 		m_bSaveMovie = true;
-		m_iMovieFrameNum = 0;
+		m_capture.begin(m_strMovieFileName.c_str(), format,
+			(format == CAPTURE_AVI) ? m_iMovieQuality : m_iMovieLevel, m_iFps, iFrameHint);
 		m_psldrFPS->deactivate();
 		currTime(m_fPlayStartTime);
 		animate(true);
@@ -241,6 +275,28 @@ void ModelerUI::cb_aniLen(Fl_Menu_* o, void* v)
 	((ModelerUI*)(o->parent()->user_data()))->cb_aniLen_i(o,v);
 }
 
+inline void ModelerUI::cb_simplifyCurves_i(Fl_Menu_*, void*) 
+{
+	float fTolerance;
+	const char* szTolerance = NULL;
+	do {
+		szTolerance = fl_input("Simplification Tolerance (in % of each curve's range) (0 ~ 100)", "1");
+
+		if (szTolerance) {
+			fTolerance = atof(szTolerance);
+			if (fTolerance >= 0.0f && fTolerance <= 100.0f) {
+				m_pwndGraphWidget->simplifyCurves(fTolerance / 100.0f);
+				m_pwndGraphWidget->redraw();
+			}
+		}
+	} while (szTolerance && (fTolerance < 0.0f || fTolerance > 100.0f));
+}
+
+void ModelerUI::cb_simplifyCurves(Fl_Menu_* o, void* v) 
+{
+	((ModelerUI*)(o->parent()->user_data()))->cb_simplifyCurves_i(o,v);
+}
+
 inline void ModelerUI::cb_fps_i(Fl_Slider*, void*) 
 {
 	fps(m_psldrFPS->value());
@@ -766,7 +822,46 @@ float ModelerUI::controlValue(int iControl) const
 	}
 	else {
 		// curve mode
-		return m_pwndGraphWidget->curve(iControl)->evaluateCurveAt(m_pwndGraphWidget->currTime());
+		const Curve* pcrv = m_pwndGraphWidget->curve(iControl);
+		const float fTime = m_pwndGraphWidget->currTime();
+
+		// during playback the time advances by 1/fps, so read the baked sample
+		// whenever it lies on the frame grid
+		if (m_bAnimating) {
+			const float fFrame = fTime * m_iFps;
+			const int iFrame = (int)(fFrame + 0.5f);
+			if (fabs(fFrame - iFrame) < 0.001f)
+				return pcrv->sampleAt(iFrame, m_iFps);
+		}
+
+		return pcrv->evaluateCurveAt(fTime);
+	}
+}
+
+// all controls in one pass, pdValues[i] is the value of control i
+// in curve mode the sliders are hidden and never read
+void ModelerUI::controlValues(double* pdValues, int iCount) const
+{
+#ifdef _DEBUG
+	assert(iCount >= 0 && iCount <= m_iCurrControlCount);
+#endif _DEBUG
+
+	if (m_ptabTab->value() != (Fl_Widget*)m_pgrpCurveGroup) {
+		// slider control mode
+		for (int i = 0; i < iCount; ++i)
+			pdValues[i] = valueSlider(i)->value();
+		return;
+	}
+
+	// curve mode
+	const float fTime = m_pwndGraphWidget->currTime();
+	const float fFrame = fTime * m_iFps;
+	const int iFrame = (int)(fFrame + 0.5f);
+	const bool bOnFrame = m_bAnimating && fabs(fFrame - iFrame) < 0.001f;
+
+	for (int i = 0; i < iCount; ++i) {
+		const Curve* pcrv = m_pwndGraphWidget->curve(i);
+		pdValues[i] = bOnFrame ? pcrv->sampleAt(iFrame, m_iFps) : pcrv->evaluateCurveAt(fTime);
 	}
 }
 
@@ -802,14 +897,9 @@ void ModelerUI::simulate(bool bSimulate)
 void ModelerUI::redrawModelerView()
 {
 	m_pwndModelerView->redraw();
-	// save the frame
+	// queue the frame; it is written while the next one is drawn
 	if (m_bSaveMovie) {
-		char szFrameNum[128];
-		_snprintf(szFrameNum, 128, "%d", m_iMovieFrameNum++);
-		std::string strFileName = m_strMovieFileName;
-		strFileName += szFrameNum;
-		strFileName += ".bmp";
-		m_pwndModelerView->saveBMP(strFileName.c_str());
+		m_pwndModelerView->captureFrame(m_capture);
 	}
 }
 
@@ -851,6 +941,10 @@ void ModelerUI::animate(bool bAnimate)
 		// otherwise, remove the callback
 		Fl::remove_timeout(cb_timed);
 
+		if (m_bSaveMovie) {
+			m_pwndModelerView->make_current();
+			m_capture.end();
+		}
 		m_bSaveMovie = false;
 	}
 
@@ -872,7 +966,9 @@ m_iCurrControlCount(0),
 m_pcbfValueChangedCallback(NULL),
 m_iFps(30),
 m_bAnimating(false),
-m_bSaveMovie(false)
+m_bSaveMovie(false),
+m_iMovieLevel(6),
+m_iMovieQuality(90)
 {
 	// setup all the callback functions...
 	m_pmiOpenAniScript->callback((Fl_Callback*)cb_openAniScript);
@@ -888,6 +984,7 @@ m_bSaveMovie(false)
 	m_pmiLowQuality->callback((Fl_Callback*)cb_low);
 	m_pmiPoorQuality->callback((Fl_Callback*)cb_poor);
 	m_pmiSetAniLen->callback((Fl_Callback*)cb_aniLen);
+	m_pmiSimplifyCurves->callback((Fl_Callback*)cb_simplifyCurves);
 	m_pbrsBrowser->callback((Fl_Callback*)cb_browser);
 	m_ptabTab->callback((Fl_Callback*)cb_tab);
 	m_pwndGraphWidget->callback((Fl_Callback*)cb_graphWidget);
@@ -13,6 +13,7 @@
 #include "modelerapp.h"
 #include "particleSystem.h"
 #include "modeleruiwindows.h"
+#include "modelercapture.h"
 
 class ModelerUI : public ModelerUIWindows
 {
@@ -33,6 +34,7 @@ public:
 	float playEndTime() const;
 	void controlValue(int iControl, float fVal);
 	float controlValue(int iControl) const;
+	void controlValues(double* pdValues, int iCount) const;
 	void setValueChangedCallback(ValueChangedCallback* pcbf);
 	void animate(bool bAnimate);
 	int fps();
@@ -41,6 +43,7 @@ public:
 	void simulate(bool bSimulate);
 	void redrawModelerView();
     void autoLoadNPlay();
+	bool openAniScript(const char* szFileName);
 
 protected:
 
@@ -50,7 +53,6 @@ protected:
 	void redrawRulers();
 	void activeCurvesChanged();
 	void indicatorRangeMarkerRange(float fMin, float fMax);
-	bool openAniScript(const char* szFileName);
 	
 private:
 
@@ -62,7 +64,9 @@ private:
 	int m_iFps;
 	float m_fPlayStartTime, m_fPlayEndTime;
 	std::string m_strMovieFileName;
-	int m_iMovieFrameNum;
+	int m_iMovieLevel;
+	int m_iMovieQuality;
+	ModelerCapture m_capture;
 
 	inline void cb_openAniScript_i(Fl_Menu_*, void*);
 	static void cb_openAniScript(Fl_Menu_*, void*);
@@ -92,6 +96,8 @@ private:
 	static void cb_poor(Fl_Menu_*, void*);
 	inline void cb_aniLen_i(Fl_Menu_*, void*);
 	static void cb_aniLen(Fl_Menu_*, void*);
+	inline void cb_simplifyCurves_i(Fl_Menu_*, void*);
+	static void cb_simplifyCurves(Fl_Menu_*, void*);
 	inline void cb_fps_i(Fl_Slider*, void*);
 	static void cb_fps(Fl_Slider*, void*);
 	inline void cb_m_modelerWindow_i(Fl_Window*, void*);
@@ -1,6 +1,10 @@
 #include "modelerview.h"
 #include "camera.h"
 #include "bitmap.h"
+#include "modelercapture.h"
+#include "ModelRayFile.h"
+#include "modelerdraw.h"
+#include "modelerraster.h"
 #include "modelerapp.h"
 #include "particleSystem.h"
 
@@ -9,11 +13,16 @@
 #include <FL/gl.h>
 #include <GL/glu.h>
 #include <cstdio>
+#include <math.h>
 
 static const int	kMouseRotationButton			= FL_LEFT_MOUSE;
 static const int	kMouseTranslationButton			= FL_MIDDLE_MOUSE;
 static const int	kMouseZoomButton				= FL_RIGHT_MOUSE;
 
+static const double	kFieldOfView					= 30.0;
+static const double	kNearPlane						= 1.0;
+static const double	kFarPlane						= 100.0;
+
 static const char *bmp_name = NULL;
 
 ModelerView::ModelerView(int x, int y, int w, int h, char *label)
@@ -93,6 +102,17 @@ static GLfloat lightDiffuse1[]  = { 1, 1, 1, 1 };
 
 void ModelerView::draw()
 {
+	// software frame: same camera and lights, no GL call
+	ModelerRaster *raster = ModelerDrawState::Instance()->m_raster;
+	if (raster != NULL)
+	{
+		raster->begin(getProjectionMatrix(), m_camera->getViewMatrix());
+		raster->setLight(0, lightPosition0, lightDiffuse0);
+		raster->setLight(1, lightPosition1, lightDiffuse1);
+		drawParticles();
+		return;
+	}
+
     if (!valid())
     {
         glShadeModel( GL_SMOOTH );
@@ -103,10 +123,13 @@ void ModelerView::draw()
 		glEnable( GL_NORMALIZE );
     }
 
+	// the context may be new, or its state changed outside of modelerdraw
+	invalidateDrawState();
+
   	glViewport( 0, 0, w(), h() );
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
-	gluPerspective(30.0,float(w())/float(h()),1.0,100.0);
+	gluPerspective(kFieldOfView,float(w())/float(h()),kNearPlane,kFarPlane);
 				
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
@@ -118,7 +141,13 @@ void ModelerView::draw()
     glLightfv( GL_LIGHT1, GL_POSITION, lightPosition1 );
     glLightfv( GL_LIGHT1, GL_DIFFUSE, lightDiffuse1 );
 
-	// If particle system exists, draw it
+	drawParticles();
+}
+
+
+// If particle system exists, draw it
+void ModelerView::drawParticles()
+{
 	ParticleSystem *ps = ModelerApplication::Instance()->GetParticleSystem();
 	if (ps != NULL) {
 		ps->computeForcesAndUpdateParticles(t);
@@ -127,6 +156,34 @@ void ModelerView::draw()
 }
 
 
+// gluPerspective of draw(), row-major
+Mat4d ModelerView::getProjectionMatrix() const
+{
+	const double aspect = double(w()) / double(h());
+	const double f = 1.0 / tan(kFieldOfView * 3.14159265358979323846 / 360.0);
+	const double depth = kNearPlane - kFarPlane;
+
+	return Mat4d(
+		f / aspect,	0,	0,									0,
+		0,			f,	0,									0,
+		0,			0,	(kFarPlane + kNearPlane) / depth,	2 * kFarPlane * kNearPlane / depth,
+		0,			0,	-1,									0);
+}
+
+
+// camera and lights of draw() for a .ray file; the lights are
+// directional (w = 0), so they shine along -position
+void ModelerView::setupRayFile(ModelRayFile& file)
+{
+	file.setCamera(m_camera->getViewMatrix(), kFieldOfView, double(w()) / double(h()));
+
+	const GLfloat direction0[] = { -lightPosition0[0], -lightPosition0[1], -lightPosition0[2] };
+	const GLfloat direction1[] = { -lightPosition1[0], -lightPosition1[1], -lightPosition1[2] };
+	file.addDirectionalLight(direction0, lightDiffuse0);
+	file.addDirectionalLight(direction1, lightDiffuse1);
+}
+
+
 /** Set the active camera **/
 void ModelerView::camera(cam_mode_t mode)
 {
@@ -182,3 +239,12 @@ void ModelerView::saveBMP(const char* szFileName)
 	delete [] imageBuffer;
 }
 
+
+// Queue the back buffer as the next movie frame, see saveBMP()
+void ModelerView::captureFrame(ModelerCapture& capture)
+{
+	make_current();
+
+	glReadBuffer(GL_BACK);
+	capture.capture(w(), h());
+}
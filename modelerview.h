@@ -10,8 +10,11 @@
 #define MODELERVIEW_H
 
 #include <FL/Fl_Gl_Window.H>
+#include "mat.h"
 
 class Camera;
+class ModelerCapture;
+class ModelRayFile;
 class ModelerView;
 typedef ModelerView* (*ModelerViewCreator_f)(int x, int y, int w, int h, char *label);
 
@@ -28,9 +31,13 @@ public:
 
 	void setBMP(const char *fname);
 	void saveBMP(const char* szFileName);
+	void captureFrame(ModelerCapture& capture);
+	void setupRayFile(ModelRayFile& file);
+	void drawParticles();
 	void endDraw();
 
 	void camera(cam_mode_t mode);
+	Mat4d getProjectionMatrix() const;
     Camera *m_camera;
 	Camera *m_ctrl_camera;
 	Camera *m_curve_camera;
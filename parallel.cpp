@@ -0,0 +1,188 @@
+#include "parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// one parallelFor call, owned by the stack of its caller
+struct ParallelJob {
+	const std::function<void(int)>*	ops;
+	int					count;
+	int					next;		// next index to hand out, under the pool mutex
+	std::atomic<int>	done;
+};
+
+
+// worker threads created on first use and kept until exit
+// jobs are a stack, so a nested call is served before the job that made it
+class ParallelPool {
+
+// Data
+protected:
+	std::mutex					mutex;
+	std::condition_variable		cv_work;
+	std::condition_variable		cv_done;
+	std::vector<ParallelJob*>	job_list;
+	std::vector<std::thread>	thread_list;
+	bool						is_stop = false;
+	int							busy_size = 0;		// workers running an index, under mutex
+	int							thread_limit = 0;	// 0 for every thread, under mutex
+
+// Operation
+public:
+	ParallelPool() {
+		const int count = std::thread::hardware_concurrency();
+		const int thread_count = count > 0 ? count : 1;
+
+		// the calling thread of each job is the last worker
+		for (int i = 0; i < thread_count - 1; i++) thread_list.push_back(std::thread([this]() { work(); }));
+	}
+
+	~ParallelPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			is_stop = true;
+		}
+		cv_work.notify_all();
+		for (size_t i = 0; i < thread_list.size(); i++) thread_list[i].join();
+	}
+
+	int threadCount() {
+		std::lock_guard<std::mutex> lock(mutex);
+		const int count = (int)thread_list.size() + 1;
+		return (thread_limit > 0 && thread_limit < count) ? thread_limit : count;
+	}
+
+	void setThreadLimit(int count) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			thread_limit = count > 0 ? count : 0;
+		}
+		cv_work.notify_all();
+	}
+
+	void run(ParallelJob* job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job_list.push_back(job);
+		}
+		cv_work.notify_all();
+
+		// the caller takes a share as well
+		for (;;) {
+			int index;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				index = claim(job);
+			}
+			if (index < 0) break;
+			execute(job, index);
+		}
+
+		// indices taken by the workers, the job leaves the stack once every index is handed out
+		std::unique_lock<std::mutex> lock(mutex);
+		cv_done.wait(lock, [job]() { return job->done == job->count; });
+	}
+
+protected:
+	void work() {
+		for (;;) {
+			ParallelJob* job;
+			int index;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv_work.wait(lock, [this]() { return is_stop || (!job_list.empty() && isWorkerFree()); });
+				if (job_list.empty()) return;
+
+				job = job_list.back();
+				index = claim(job);
+				if (index < 0) continue;
+				busy_size++;
+			}
+			execute(job, index);
+
+			// a worker held back by the limit may take its place
+			bool is_limited;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				busy_size--;
+				is_limited = thread_limit > 0;
+			}
+			if (is_limited) cv_work.notify_one();
+		}
+	}
+
+	// under mutex; the caller of a job is one of the limit, so the workers get the rest
+	bool isWorkerFree() {
+		return thread_limit <= 0 || busy_size < thread_limit - 1;
+	}
+
+	// under mutex, -1 when every index is handed out
+	int claim(ParallelJob* job) {
+		if (job->next >= job->count) return -1;
+
+		const int index = job->next++;
+		if (job->next == job->count) {
+			for (size_t i = 0; i < job_list.size(); i++) {
+				if (job_list[i] != job) continue;
+				job_list.erase(job_list.begin() + i);
+				break;
+			}
+		}
+		return index;
+	}
+
+	void execute(ParallelJob* job, int index) {
+		(*job->ops)(index);
+
+		// the job may be gone once done reaches count, only the pool is touched after;
+		// count is read before, the caller can return as soon as the increment lands
+		const int count = job->count;
+		if (++job->done == count) {
+			std::lock_guard<std::mutex> lock(mutex);
+			cv_done.notify_all();
+		}
+	}
+};
+
+
+static ParallelPool& Helper_getPool() {
+	static ParallelPool pool;
+	return pool;
+}
+
+
+// Operation Handling
+int parallelThreadCount()
+{
+	return Helper_getPool().threadCount();
+}
+
+
+void parallelSetThreadLimit(int count)
+{
+	Helper_getPool().setThreadLimit(count);
+}
+
+
+void parallelFor(const int count, const std::function<void(int)>& ops)
+{
+	if (count <= 0) return;
+
+	// serial path, nothing to share
+	ParallelPool& pool = Helper_getPool();
+	if (count == 1 || pool.threadCount() == 1) {
+		for (int i = 0; i < count; i++) ops(i);
+		return;
+	}
+
+	ParallelJob job;
+	job.ops = &ops;
+	job.count = count;
+	job.next = 0;
+	job.done = 0;
+	pool.run(&job);
+}
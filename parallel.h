@@ -0,0 +1,19 @@
+#ifndef PARALLEL_H_INCLUDED
+#define PARALLEL_H_INCLUDED
+
+#include <functional>
+
+// run ops(i) for every i in [0, count) across the hardware threads,
+// returns after every index is done
+// the threads are created on the first call and reused; a call made from
+// inside ops is shared with the idle threads as well
+void parallelFor(const int count, const std::function<void(int)>& ops);
+
+// number of threads parallelFor() spreads the work over
+int parallelThreadCount();
+
+// cap the threads parallelFor() uses at once, caller included, e.g. when
+// several processes share the machine; 0 or less lifts the cap
+void parallelSetThreadLimit(int count);
+
+#endif // PARALLEL_H_INCLUDED
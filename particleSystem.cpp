@@ -9,6 +9,7 @@
 
 #include "particleSystem.h"
 #include "modelerdraw.h"
+#include "modelerraster.h"
 
 
 ParticleSystem::ParticleSystem() {
@@ -111,11 +112,23 @@ void ParticleSystem::drawParticles(float t) {
 	if (bake_start_time < 0) return;
 	if (t < bake_start_time || t > bake_end_time) return;
 
+	// the raster does not see glTranslated, it is given the matrix
+	ModelerRaster* raster = ModelerDrawState::Instance()->m_raster;
+
 	// find the closest frame
 	for (auto* frame : particle_frame) {
 		if (t > frame->time) continue;
 
 		for (auto& particle : frame->particles) {
+			if (raster != nullptr) {
+				raster->setModel(Mat4d::createTranslation(
+					particle->position[0],
+					particle->position[1],
+					particle->position[2]));
+				drawSphere(0.1);
+				continue;
+			}
+
 			glPushMatrix();
 			glTranslated(
 				particle->position[0],
@@ -124,6 +137,7 @@ void ParticleSystem::drawParticles(float t) {
 			drawSphere(0.1);
 			glPopMatrix();
 		}
+		if (raster != nullptr) raster->setModel(Mat4d());
 		return;
 	}
 }
@@ -0,0 +1,55 @@
+//
+// pngfile.cpp
+//
+// PNG output.  Everything lives in the png/info structs of one call,
+// so frames can be encoded on several threads at once.
+//
+
+#include "pngfile.h"
+
+#include <png.h>
+#include <stdio.h>
+#include <vector>
+
+bool writePNG(const char* szFileName, int iWidth, int iHeight, const unsigned char* pbyData, int iLevel)
+{
+	if (iLevel < 0) iLevel = 0;
+	if (iLevel > 9) iLevel = 9;
+
+	FILE* pfPNGFile = fopen(szFileName, "wb");
+	if (pfPNGFile == NULL)
+		return false;
+
+	png_structp pPng = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop pInfo = (pPng != NULL) ? png_create_info_struct(pPng) : NULL;
+	if (pInfo == NULL) {
+		png_destroy_write_struct(&pPng, NULL);
+		fclose(pfPNGFile);
+		return false;
+	}
+
+	// PNG stores rows top-down, the GL readback is bottom-up
+	std::vector<png_bytep> vRows(iHeight);
+	for (int j = 0; j < iHeight; ++j)
+		vRows[j] = (png_bytep)(pbyData + (iHeight - 1 - j) * 3 * iWidth);
+
+	if (setjmp(png_jmpbuf(pPng))) {
+		png_destroy_write_struct(&pPng, &pInfo);
+		fclose(pfPNGFile);
+		return false;
+	}
+
+	png_init_io(pPng, pfPNGFile);
+	png_set_compression_level(pPng, iLevel);
+	// at the fast levels row filtering costs more time than it saves space
+	if (iLevel <= 1)
+		png_set_filter(pPng, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+
+	png_set_IHDR(pPng, pInfo, iWidth, iHeight, 8, PNG_COLOR_TYPE_RGB,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_set_rows(pPng, pInfo, &vRows[0]);
+	png_write_png(pPng, pInfo, PNG_TRANSFORM_IDENTITY, NULL);
+
+	png_destroy_write_struct(&pPng, &pInfo);
+	return fclose(pfPNGFile) == 0;
+}
@@ -0,0 +1,14 @@
+//
+// pngfile.h
+//
+// header file for PNG output, through the libpng bundled with fltk
+//
+
+#ifndef PNGFILE_H
+#define PNGFILE_H
+
+// write bottom-up RGB rows, the layout writeBMP() takes, as a PNG;
+// iLevel is the zlib compression level, 0 (fastest) to 9 (smallest)
+extern bool writePNG(const char *szFileName, int iWidth, int iHeight, const unsigned char *pbyData, int iLevel);
+
+#endif
@@ -26,9 +26,15 @@ void PointObject::modelSelf() {
 }
 
 
+// nothing is drawn, particles are drawn by the particle system
+ModelBound PointObject::getLocalBound() {
+	return ModelBound();
+}
+
+
 // control
 void PointObject::controlSelf(std::vector<ModelControl*>* controls) {
-	ModelControl* control_0 = new ModelControl(&emit, 0, 20);
+	ModelControl* control_0 = Helper_createControl(this, &emit, 0, 20);
 	control_0->appendName(name);
 	control_0->appendName(": Count");
 	controls->push_back(control_0);
@@ -22,6 +22,7 @@ public:
 
 	// model
 	void modelSelf() override;
+	ModelBound getLocalBound() override;
 
 	// control
 	void controlSelf(std::vector<ModelControl*>* controls) override;
@@ -1,6 +1,7 @@
 // The sample model.  You should build a file
 // very similar to this for when you make your model.
 #include "modelerview.h"
+#include "camera.h"
 #include "modelerapp.h"
 #include "modelerdraw.h"
 #include "modelerglobals.h"
@@ -13,6 +14,15 @@
 #include "ModelObject_Cylinder.h"
 #include "ModelObject_Prism.h"
 #include "ModelObject_Torus.h"
+#include "ModelScene.h"
+#include "ModelChannelTable.h"
+#include "ModelSceneFile.h"
+#include "ModelRayFile.h"
+#include "ModelRig.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
 
 
 // Data
@@ -32,6 +42,22 @@ ModelObject_Box model_RF;
 ModelObject_Prism model_hat;
 ModelObject_Torus model_torus;
 
+// scene in use, either from sample.scene or the objects above
+ModelSceneFile scene_file;
+ModelObject* node_root = &model_body;
+ModelObject* node_RLA = &model_RLA;
+ModelObject* node_hat = &model_hat;
+ModelObject* node_torus = &model_torus;
+
+// flattened tree of node_root, built once the tree is complete
+ModelScene model_scene;
+
+// crowd behind the figure, one ModelRig instance each (--crowd <count>)
+// variant 1 is a taller copy of the figure with a larger torus
+ModelRig crowd_rig;
+ModelArena crowd_arena;
+int crowd_size = 0;
+
 GLdouble control_global_buffer[4];
 ModelControl control_global_x(control_global_buffer + 0, -5, 5);
 ModelControl control_global_y(control_global_buffer + 1, -5, 5);
@@ -42,12 +68,21 @@ GLdouble control_multi_buffer[1];
 ModelControl control_multi_action(control_multi_buffer + 0, -90, 90);
 
 std::vector<ModelControl*> controls;
+ModelChannelTable channel_table;	// slot i is control i
 int control_size = 0;
 ModelerControl* control_table = nullptr;
 
 
 // Static Function
 static void callback_valChanged();
+static void callback_ray(ModelRayFile* file);
+static void callback_evaluate();
+static Mat4d getRootMatrix();
+static void buildScene_default();
+static void buildCrowd();
+static int checkScene(const char* path, int count);
+static void updateCrowd();
+static ModelObject* Helper_cloneTall(ModelObject* node, ModelArena* arena);
 
 
 // To make a SampleModel, we inherit off of ModelerView
@@ -79,35 +114,165 @@ void SampleModel::draw() {
 	setAmbientColor(.1f, .1f, .1f);
 	setDiffuseColor(COLOR_GREEN);
 
-	// get the reference matrix before global translation
-	Mat4d mat;
-	glGetDoublev(GL_MODELVIEW_MATRIX, mat.n);
-	mat = mat.transpose();
-	mat = mat.inverse();
-
-	// global translation
-	glPushMatrix();
-	glScaled(
-		control_global_buffer[3],
-		control_global_buffer[3],
-		control_global_buffer[3]);
-	glTranslated(
-		control_global_buffer[0],
-		control_global_buffer[1], 
-		control_global_buffer[2]);
+	// model
+	// only the nodes changed since the last frame are re-evaluated
+	callback_evaluate();
+	model_scene.draw(getProjectionMatrix() * m_camera->getViewMatrix(), h());
+
+	// crowd
+	if (crowd_size > 0) {
+		updateCrowd();
+		crowd_rig.draw(getProjectionMatrix() * m_camera->getViewMatrix(), h());
+	}
+}
+
+
+int main(int argc, char* argv[]) {
+	// --check-scene <file> [count]: no window, see checkScene
+	if (argc >= 3 && strcmp(argv[1], "--check-scene") == 0) return checkScene(argv[2], argc >= 4 ? atoi(argv[3]) : 50);
+
+	// --crowd <count> is taken out before ModelerApplication sees the arguments
+	for (int i = 1; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--crowd") != 0) continue;
+		crowd_size = atoi(argv[i + 1]);
+		for (int j = i + 2; j <= argc; j++) argv[j - 2] = argv[j];
+		argc -= 2;
+		break;
+	}
 
 	// model
-	model_body.model(mat);
+	// loaded from sample.scene when present, otherwise built in code
+	if (scene_file.load("sample.scene")) {
+		node_root = scene_file.getRoot();
+		node_RLA = scene_file.find("RLA");
+		node_hat = scene_file.find("Hat");
+		node_torus = scene_file.find("Torus");
+	} else {
+		buildScene_default();
+	}
+
+	// crowd
+	// built before the particle point is added, the point is not part of a figure
+	if (crowd_size > 0) buildCrowd();
+
+	// particle system
+	ParticleSystem* particle_system = new ParticleSystem();
+	PointObject* model_point = particle_system->getPointObject();
+	model_point->setName("Particle");
+	if (node_RLA != nullptr) node_RLA->add(model_point, 0);
+
+	// scene
+	model_scene.build(node_root);
+
+	// control
+	control_global_x.appendName("Global X");
+	control_global_y.appendName("Global Y");
+	control_global_z.appendName("Global Z");
+	control_global_scale.appendName("Global Scale");
+	control_multi_action.appendName("Mutli Part Action");
+	control_multi_action.setLimit(0, 2);
+	control_global_buffer[3] = 1;
+
+	controls.push_back(&control_global_x);
+	controls.push_back(&control_global_y);
+	controls.push_back(&control_global_z);
+	controls.push_back(&control_global_scale);
+	controls.push_back(&control_multi_action);
 
-	// global movement: pop
-	glPopMatrix();
+	scene_file.control(node_root, &controls);
+
+	control_size = (int)controls.size();
+	channel_table.build(&controls);
+	control_table = scene_file.getArena()->createArray<ModelerControl>(control_size);
+	
+	int i = 0;
+	for (ModelControl *control : controls) {
+		control_table[i].SetVals(
+			control->getName()->c_str(),
+			control->getLimit_min(),
+			control->getLimit_max(),
+			(control->getLimit_max() - control->getLimit_max()) / 100,
+			control->getValue());
+		i++;
+	}
+
+	// mainloop
+    ModelerApplication::Instance()->Init(&createSampleModel, control_table, control_size);
+	ModelerApplication::Instance()->setExtCallback_slider(callback_valChanged);
+	ModelerApplication::Instance()->setExtCallback_ray(callback_ray);
+	ModelerApplication::Instance()->setExtCallback_evaluate(callback_evaluate);
+	ModelerApplication::Instance()->SetParticleSystem(particle_system);
+	if (crowd_size > 0) {
+		ModelerApplication::Instance()->AddWorkerArgument("--crowd");
+		ModelerApplication::Instance()->AddWorkerArgument(std::to_string(crowd_size).c_str());
+	}
+	return ModelerApplication::Instance()->Run(argc, argv);
 }
 
 
-int main() {
-	// model
-	// Feature
-	// Example of Creating a Minecraft Man
+// Static Function Implementation
+static void callback_valChanged() {
+	// evaluate every channel into the table, then write the changed ones to the model
+	ModelerApplication::Instance()->GetControlValues(channel_table.getData(), channel_table.size());
+	channel_table.apply();
+
+	// for mutli action
+	// hat and torus
+	if (node_hat != nullptr) {
+		GLdouble* origin_hat = node_hat->getOrigin();
+		node_hat->setOrigin(origin_hat[0], control_multi_buffer[0], origin_hat[2]);
+	}
+	if (node_torus != nullptr) {
+		GLdouble* origin_torus = node_torus->getOrigin();
+		node_torus->setOrigin(origin_torus[0], control_multi_buffer[0] * 2, origin_torus[2]);
+	}
+
+	// dimension controls move the attachments of the template
+	if (crowd_size > 0) crowd_rig.updateTemplate();
+}
+
+
+// same color and root as SampleModel::draw, matrices are evaluated without GL
+static void callback_ray(ModelRayFile* file) {
+	const GLfloat diffuse[] = { COLOR_GREEN };
+	const GLfloat ambient[] = { .1f, .1f, .1f };
+	file->setMaterial(diffuse, ambient);
+
+	callback_evaluate();
+	model_scene.exportRay(file);
+
+	if (crowd_size > 0) {
+		updateCrowd();
+		crowd_rig.exportRay(file);
+	}
+}
+
+
+
+// world matrices of SampleModel::draw, without drawing
+static void callback_evaluate() {
+	model_scene.setRoot(getRootMatrix());
+	model_scene.transform();
+}
+
+
+// global translation
+// the model is placed in world space, after the camera transform
+static Mat4d getRootMatrix() {
+	return
+		Mat4d::createScale(
+			control_global_buffer[3],
+			control_global_buffer[3],
+			control_global_buffer[3]) *
+		Mat4d::createTranslation(
+			control_global_buffer[0],
+			control_global_buffer[1],
+			control_global_buffer[2]);
+}
+
+
+// Example of Creating a Minecraft Man
+static void buildScene_default() {
 	model_body.setName("Body");
 	model_head.setName("Head");
 	model_LUA.setName("LUA");
@@ -154,62 +319,108 @@ int main() {
 	model_LLL.add(&model_LF, 0);
 	model_RLL.add(&model_RF, 0);
 	model_head.add(&model_torus, 0);
+}
 
-	// particle system
-	ParticleSystem* particle_system = new ParticleSystem();
-	PointObject* model_point = particle_system->getPointObject();
-	model_point->setName("Particle");
-	model_RLA.add(model_point, 0);
 
-	// control
-	control_global_x.appendName("Global X");
-	control_global_y.appendName("Global Y");
-	control_global_z.appendName("Global Z");
-	control_global_scale.appendName("Global Scale");
-	control_multi_action.appendName("Mutli Part Action");
-	control_multi_action.setLimit(0, 2);
-	control_global_buffer[3] = 1;
+// load the scene, build its controls, control table and flattened tree, then clear it,
+// count times; run under a leak checker (ASan, CRT debug heap) to see that the arena
+// of the file releases everything
+static int checkScene(const char* path, int count) {
+	ModelSceneFile file;
 
-	controls.push_back(&control_global_x);
-	controls.push_back(&control_global_y);
-	controls.push_back(&control_global_z);
-	controls.push_back(&control_global_scale);
-	controls.push_back(&control_multi_action);
+	for (int i = 0; i < count; i++) {
+		if (!file.load(path)) {
+			fprintf(stderr, "ERROR: can't load %s: %s\n", path, file.getError());
+			return -1;
+		}
 
-	model_body.control(&controls);
+		std::vector<ModelControl*> list;
+		file.control(file.getRoot(), &list);
+		file.getArena()->createArray<ModelerControl>(list.size());
 
-	control_size = (int)controls.size();
-	control_table = new ModelerControl[control_size];
-	
-	int i = 0;
-	for (ModelControl *control : controls) {
-		control_table[i].SetVals(
-			control->getName()->c_str(),
-			control->getLimit_min(),
-			control->getLimit_max(),
-			(control->getLimit_max() - control->getLimit_max()) / 100,
-			control->getValue());
-		i++;
+		// the scene holds the nodes, it goes before the file is cleared
+		{
+			ModelScene scene;
+			scene.build(file.getRoot());
+			scene.transform();
+		}
+
+		file.clear();
 	}
 
-	// mainloop
-    ModelerApplication::Instance()->Init(&createSampleModel, control_table, control_size);
-	ModelerApplication::Instance()->setExtCallback_slider(callback_valChanged);
-	ModelerApplication::Instance()->SetParticleSystem(particle_system);
-	return ModelerApplication::Instance()->Run();
+	printf("%s: loaded and cleared %d times\n", path, count);
+	return 0;
 }
 
+// crowd of crowd_size figures, every third one in the tall variant
+static void buildCrowd() {
+	crowd_rig.build(node_root);
+	const int32_t variant = crowd_rig.addVariant(Helper_cloneTall(node_root, &crowd_arena));
 
-// Static Function Implementation
-static void callback_valChanged() {
-	for (int i = 0; i < control_size; i++) {
-		controls[i]->setValue(ModelerApplication::Instance()->GetControlValue(i));
+	crowd_rig.setInstanceSize(crowd_size);
+	for (int32_t k = 0; k < crowd_size; k++) {
+		if (variant > 0 && k % 3 == 2) crowd_rig.setVariant(k, variant);
 	}
+}
 
-	// for mutli action
-	// hat and torus
-	GLdouble* origin_hat = model_hat.getOrigin();
-	GLdouble* origin_torus = model_torus.getOrigin();
-	model_hat.setOrigin(origin_hat[0], control_multi_buffer[0], origin_hat[2]);
-	model_torus.setOrigin(origin_torus[0], control_multi_buffer[0] * 2, origin_torus[2]);
+
+// every figure follows the pose of the model, each with its own amplitude,
+// placed on a grid of ten per row behind it
+static void updateCrowd() {
+	const int32_t node_size = crowd_rig.getNodeSize();
+	const Mat4d root = getRootMatrix();
+
+	for (int32_t i = 0; i < node_size; i++) {
+		ModelObject* node = crowd_rig.getNode(0, i);
+		const GLdouble* origin = node->getOrigin();
+		const GLdouble* rotation = node->getRotation();
+
+		for (int32_t j = 0; j < 3; j++) {
+			GLdouble* channel_origin = crowd_rig.getChannelData(crowd_rig.getChannelIndex(i, (ModelRig::ChannelType)(ModelRig::CHANNEL_ORIGIN_X + j)));
+			GLdouble* channel_rotation = crowd_rig.getChannelData(crowd_rig.getChannelIndex(i, (ModelRig::ChannelType)(ModelRig::CHANNEL_ROTATION_X + j)));
+
+			for (int32_t k = 0; k < crowd_size; k++) {
+				const GLdouble amplitude = 0.6 + 0.4 * ((k * 7) % 10) / 9.0;
+				channel_origin[k] = origin[j];
+				channel_rotation[k] = rotation[j] * amplitude;
+			}
+		}
+	}
+
+	for (int32_t k = 0; k < crowd_size; k++) {
+		crowd_rig.setRoot(k, root * Mat4d::createTranslation((k % 10 - 4.5) * 1.5, 0, -3 - (k / 10) * 2));
+	}
+
+	crowd_rig.transform();
+}
+
+
+// copy of the tree under node, 1.3 times taller and with a larger torus
+// nullptr for a node of another type, so the variant is refused by the rig
+static ModelObject* Helper_cloneTall(ModelObject* node, ModelArena* arena) {
+	ModelObject* clone = nullptr;
+	if (dynamic_cast<ModelObject_Box*>(node) != nullptr)		clone = arena->create<ModelObject_Box>();
+	else if (dynamic_cast<ModelObject_Sphere*>(node) != nullptr)	clone = arena->create<ModelObject_Sphere>();
+	else if (dynamic_cast<ModelObject_Cylinder*>(node) != nullptr)	clone = arena->create<ModelObject_Cylinder>();
+	else if (dynamic_cast<ModelObject_Prism*>(node) != nullptr)		clone = arena->create<ModelObject_Prism>();
+	else if (dynamic_cast<ModelObject_Torus*>(node) != nullptr) {
+		ModelObject_Torus* torus = arena->create<ModelObject_Torus>();
+		torus->setParameter(24, 16, 1.4, 0.35);
+		clone = torus;
+	}
+	if (clone == nullptr) return nullptr;
+
+	const GLdouble* origin = node->getOrigin();
+	const GLdouble* dimension = node->getDimension();
+	const GLdouble* rotation = node->getRotation();
+	clone->setOrigin(origin[0], origin[1], origin[2]);
+	clone->setDimension(dimension[0], dimension[1] * 1.3, dimension[2]);
+	clone->setRotation(rotation[0], rotation[1], rotation[2]);
+
+	for (ModelObject* child : *node->getChildren()) {
+		ModelObject* child_clone = Helper_cloneTall(child, arena);
+		if (child_clone == nullptr) return nullptr;
+		clone->add(child_clone, child->getAttachIndex());
+	}
+	return clone;
 }
@@ -0,0 +1,72 @@
+#ifndef SPLINE_KERNEL_H_INCLUDED
+#define SPLINE_KERNEL_H_INCLUDED
+
+#pragma warning(disable : 4786)
+
+#include "Point.h"
+
+
+// Basis
+// a basis maps the 4 points of one segment to the 4 control points of the equivalent cubic Bezier,
+// bezier[row] = sum(weight(row, col) * point[col]) / denominator()
+// weights are integers, so the conversion is resolved at compile time and zero terms fold away
+// knot: the curve passes through point[1] and point[2]
+
+struct BSplineBasis {
+	static constexpr bool knot = false;
+	static constexpr int denominator() { return 6; }
+	static constexpr int weight(int row, int col) {
+		return
+			row == 0 ? (col == 0 ? 1 : col == 1 ? 4 : col == 2 ? 1 : 0) :
+			row == 1 ? (col == 1 ? 4 : col == 2 ? 2 : 0) :
+			row == 2 ? (col == 1 ? 2 : col == 2 ? 4 : 0) :
+					   (col == 1 ? 1 : col == 2 ? 4 : col == 3 ? 1 : 0);
+	}
+};
+
+
+// tension = Numerator / Denominator, tangent at point[1] = tension * (point[2] - point[0])
+// 1 / 2 is the standard Catmull-Rom spline
+template <int Numerator = 1, int Denominator = 2>
+struct CatmullRomBasis {
+	static constexpr bool knot = true;
+	static constexpr int denominator() { return 3 * Denominator; }
+	static constexpr int weight(int row, int col) {
+		return
+			row == 0 ? (col == 1 ? 3 * Denominator : 0) :
+			row == 1 ? (col == 0 ? -Numerator : col == 1 ? 3 * Denominator : col == 2 ? Numerator : 0) :
+			row == 2 ? (col == 1 ? Numerator : col == 2 ? 3 * Denominator : col == 3 ? -Numerator : 0) :
+					   (col == 2 ? 3 * Denominator : 0);
+	}
+};
+
+
+// Kernel
+template <class Basis>
+class SplineKernel {
+public:
+	static void toBezier(
+		const Point& pt_1, const Point& pt_2, const Point& pt_3, const Point& pt_4,
+		Point& dst_1, Point& dst_2, Point& dst_3, Point& dst_4) {
+
+		dst_1 = row<0>(pt_1, pt_2, pt_3, pt_4);
+		dst_2 = row<1>(pt_1, pt_2, pt_3, pt_4);
+		dst_3 = row<2>(pt_1, pt_2, pt_3, pt_4);
+		dst_4 = row<3>(pt_1, pt_2, pt_3, pt_4);
+	}
+
+private:
+	template <int Row>
+	static Point row(const Point& pt_1, const Point& pt_2, const Point& pt_3, const Point& pt_4) {
+		Point pt =
+			pt_1 * (float)Basis::weight(Row, 0) +
+			pt_2 * (float)Basis::weight(Row, 1) +
+			pt_3 * (float)Basis::weight(Row, 2) +
+			pt_4 * (float)Basis::weight(Row, 3);
+		pt /= (float)Basis::denominator();
+		return pt;
+	}
+};
+
+
+#endif // SPLINE_KERNEL_H_INCLUDED